@@ -0,0 +1,312 @@
+/*
+ * Copyright (c) 2013 David Wicks, sansumbrella.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ Micro-benchmarks of the entityx operations PupTent leans on, each at
+ several world sizes:
+   create, destroy        entity churn
+   assign, remove         adding and dropping a component
+   component              component<T>() lookup
+   iterate                entities_with_components<A, B>() with B on 1-100% of entities
+   emit                   EventManager::emit() with 0, 1 and 8 receivers
+   tags_view              TagsComponent::view() with 10% of entities tagged
+
+ Prints one CSV row per case; ns_per_op is per entity, event or matched entity.
+ Smaller worlds are run several times over, so every case does about a million operations.
+ The check column sums what each case touched, so broken runs stand out.
+ Pass world sizes to override the default 1000 100000 1000000.
+
+ Only needs entityx and boost:
+ g++ -O2 -std=c++11 -pthread -Isrc benchmarks/EntityBenchmark.cc src/entityx/[A-Z]*.cc src/entityx/tags/[A-Z]*.cc -o entity_bench && ./entity_bench
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "entityx/Entity.h"
+#include "entityx/Event.h"
+#include "entityx/tags/TagsComponent.h"
+
+using namespace entityx;
+using namespace std;
+
+struct Position : public Component<Position>
+{
+  Position( float x = 0.0f, float y = 0.0f ):
+  x( x ),
+  y( y )
+  {}
+  float x, y;
+};
+
+struct Velocity : public Component<Velocity>
+{
+  Velocity( float x = 1.0f, float y = 1.0f ):
+  x( x ),
+  y( y )
+  {}
+  float x, y;
+};
+
+struct Ping : public Event<Ping>
+{
+  explicit Ping( uint64_t value ):
+  value( value )
+  {}
+  uint64_t value;
+};
+
+struct PingCounter : public Receiver<PingCounter>
+{
+  void receive( const Ping &ping ) { sum += ping.value; }
+  uint64_t sum = 0;
+};
+
+typedef chrono::high_resolution_clock Clock;
+
+double seconds_since( Clock::time_point start )
+{
+  return chrono::duration<double>( Clock::now() - start ).count();
+}
+
+void report( const char *benchmark, size_t entities, const string &variant, uint64_t ops, double seconds, uint64_t check )
+{
+  printf( "%s,%zu,%s,%llu,%.6f,%.2f,%llu\n", benchmark, entities, variant.c_str(), (unsigned long long)ops,
+          seconds, seconds * 1.0e9 / ops, (unsigned long long)check );
+}
+
+// a fresh world of n entities, each with a Position
+ptr<EntityManager> populate( size_t n, vector<Entity> &entities )
+{
+  auto es = EntityManager::make( EventManager::make() );
+  entities.clear();
+  entities.reserve( n );
+  for( size_t i = 0; i < n; ++i )
+  {
+    entities.push_back( es->create() );
+    entities.back().assign<Position>( float( i ), 0.0f );
+  }
+  return es;
+}
+
+// enough passes over small worlds that each case runs about a million operations
+size_t passes( size_t n )
+{
+  return max<size_t>( 1, 1000000 / n );
+}
+
+void run_structure( size_t n )
+{
+  double seconds[5] = { 0.0, 0.0, 0.0, 0.0, 0.0 };
+  uint64_t checks[5] = { 0, 0, 0, 0, 0 };
+  for( size_t pass = 0; pass < passes( n ); ++pass )
+  {
+    vector<Entity> entities;
+    auto es = EntityManager::make( EventManager::make() );
+    entities.reserve( n );
+
+    auto start = Clock::now();
+    for( size_t i = 0; i < n; ++i )
+    {
+      entities.push_back( es->create() );
+    }
+    seconds[0] += seconds_since( start );
+    checks[0] += es->size();
+
+    start = Clock::now();
+    for( auto &entity : entities )
+    {
+      entity.assign<Position>( 1.0f, 2.0f );
+    }
+    seconds[1] += seconds_since( start );
+    for( auto entity : es->entities_with_components<Position>() )
+    {
+      checks[1] += 1;
+    }
+
+    start = Clock::now();
+    for( auto &entity : entities )
+    {
+      entity.remove<Position>();
+    }
+    seconds[2] += seconds_since( start );
+    for( auto entity : es->entities_with_components<Position>() )
+    {
+      checks[2] += 1;
+    }
+
+    start = Clock::now();
+    for( auto &entity : entities )
+    {
+      entity.destroy();
+    }
+    seconds[3] += seconds_since( start );
+    checks[3] += es->size();
+
+    // the freed slots are reused from here on
+    entities.clear();
+    start = Clock::now();
+    for( size_t i = 0; i < n; ++i )
+    {
+      entities.push_back( es->create() );
+    }
+    seconds[4] += seconds_since( start );
+    checks[4] += es->size();
+  }
+  uint64_t ops = n * passes( n );
+  report( "create", n, "fresh", ops, seconds[0], checks[0] );
+  report( "assign", n, "Position", ops, seconds[1], checks[1] );
+  report( "remove", n, "Position", ops, seconds[2], checks[2] );
+  report( "destroy", n, "empty", ops, seconds[3], checks[3] );
+  report( "create", n, "recycled", ops, seconds[4], checks[4] );
+}
+
+void run_component( size_t n )
+{
+  vector<Entity> entities;
+  auto es = populate( n, entities );
+  uint64_t sum = 0;
+  auto start = Clock::now();
+  for( size_t pass = 0; pass < passes( n ); ++pass )
+  {
+    for( auto &entity : entities )
+    {
+      sum += uint64_t( entity.component<Position>()->x );
+    }
+  }
+  report( "component", n, "present", n * passes( n ), seconds_since( start ), sum );
+
+  uint64_t missing = 0;
+  start = Clock::now();
+  for( size_t pass = 0; pass < passes( n ); ++pass )
+  {
+    for( auto &entity : entities )
+    {
+      missing += !entity.component<Velocity>();
+    }
+  }
+  report( "component", n, "absent", n * passes( n ), seconds_since( start ), missing );
+}
+
+void run_iterate( size_t n )
+{
+  for( int percent : { 1, 10, 50, 100 } )
+  {
+    vector<Entity> entities;
+    auto es = populate( n, entities );
+    for( size_t i = 0; i < n; ++i )
+    { // spread evenly, as a component on some fraction of a scene would be
+      if( i * percent / 100 != ( i + 1 ) * percent / 100 )
+      {
+        entities[i].assign<Velocity>();
+      }
+    }
+    uint64_t matched = 0;
+    auto start = Clock::now();
+    for( size_t pass = 0; pass < passes( n ); ++pass )
+    {
+      for( auto entity : es->entities_with_components<Position, Velocity>() )
+      {
+        auto position = entity.component<Position>();
+        auto velocity = entity.component<Velocity>();
+        position->x += velocity->x;
+        matched += 1;
+      }
+    }
+    report( "iterate", n, "density=" + to_string( percent ) + "%", max<uint64_t>( matched, 1 ), seconds_since( start ), matched );
+  }
+}
+
+void run_emit( size_t n )
+{
+  for( int receivers : { 0, 1, 8 } )
+  {
+    auto events = EventManager::make();
+    vector<PingCounter> counters( receivers );
+    for( auto &counter : counters )
+    {
+      events->subscribe<Ping>( counter );
+    }
+    uint64_t ops = n * passes( n );
+    auto start = Clock::now();
+    for( uint64_t i = 0; i < ops; ++i )
+    {
+      events->emit<Ping>( 1 );
+    }
+    double seconds = seconds_since( start );
+    uint64_t sum = 0;
+    for( auto &counter : counters )
+    {
+      sum += counter.sum;
+    }
+    report( "emit", n, "receivers=" + to_string( receivers ), ops, seconds, sum );
+  }
+}
+
+void run_tags( size_t n )
+{
+  vector<Entity> entities;
+  auto es = populate( n, entities );
+  for( size_t i = 0; i < n; i += 10 )
+  {
+    entities[i].assign<tags::TagsComponent>( "treasure" );
+  }
+  uint64_t matched = 0;
+  auto start = Clock::now();
+  for( size_t pass = 0; pass < passes( n ); ++pass )
+  {
+    for( auto entity : tags::TagsComponent::view( es->entities_with_components<Position>(), "treasure" ) )
+    {
+      matched += 1;
+    }
+  }
+  report( "tags_view", n, "tagged=10%", max<uint64_t>( matched, 1 ), seconds_since( start ), matched );
+}
+
+int main( int argc, char *argv[] )
+{
+  vector<size_t> sizes;
+  for( int i = 1; i < argc; ++i )
+  {
+    sizes.push_back( strtoull( argv[i], nullptr, 10 ) );
+  }
+  if( sizes.empty() )
+  {
+    sizes = { 1000, 100000, 1000000 };
+  }
+  printf( "benchmark,entities,variant,operations,seconds,ns_per_op,check\n" );
+  for( size_t n : sizes )
+  {
+    run_structure( n );
+    run_component( n );
+    run_iterate( n );
+    run_emit( n );
+    run_tags( n );
+  }
+  return 0;
+}
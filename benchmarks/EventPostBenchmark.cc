@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2013 David Wicks, sansumbrella.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ Measures EventManager::post() throughput with several producer threads
+ posting while the main thread drains into an ordinary receiver.
+ Also checks that a receiver may emit and drain from inside a drain.
+
+ Only needs entityx and boost:
+ g++ -O2 -std=c++11 -pthread -Isrc benchmarks/EventPostBenchmark.cc src/entityx/[A-Z]*.cc -o post_bench && ./post_bench
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include "entityx/Event.h"
+
+using namespace entityx;
+using namespace std;
+
+struct Sample : public Event<Sample>
+{
+  Sample( int producer, uint64_t value ):
+  producer( producer ),
+  value( value )
+  {}
+  int       producer;
+  uint64_t  value;
+};
+
+struct Tally : public Receiver<Tally>
+{
+  void receive( const Sample &sample ) { count += 1; sum += sample.value; }
+  uint64_t count = 0;
+  uint64_t sum = 0;
+};
+
+struct Step : public Event<Step>
+{
+  explicit Step( int value ):
+  value( value )
+  {}
+  int value;
+};
+
+struct Stepper : public Receiver<Stepper>
+{
+  void receive( const Step &step )
+  {
+    count += 1;
+    if( step.value < 3 )
+    { // a nested drain must deliver only the new event, not our batch again
+      events->emit<Step>( step.value + 1 );
+      events->drain();
+    }
+  }
+  EventManager  *events = nullptr;
+  int           count = 0;
+};
+
+void check_nested_drain()
+{
+  auto events = EventManager::make();
+  events->queue<Step>();
+  Stepper stepper;
+  stepper.events = events.get();
+  events->subscribe<Step>( stepper );
+  events->emit<Step>( 0 );
+  events->emit<Step>( 0 );
+  events->drain();
+  events->drain();
+  printf( "nested_drain,%d,%s\n", stepper.count, stepper.count == 8 ? "ok" : "MISMATCH" );
+}
+
+void run( int producers, uint64_t per_producer, size_t capacity )
+{
+  auto events = EventManager::make();
+  events->enable_posting( capacity );
+  Tally tally;
+  events->subscribe<Sample>( tally );
+
+  atomic<uint64_t> rejected( 0 );
+  atomic<int> running( producers );
+  auto start = chrono::high_resolution_clock::now();
+  vector<thread> threads;
+  for( int p = 0; p < producers; ++p )
+  {
+    threads.emplace_back( [&, p] {
+      uint64_t full = 0;
+      for( uint64_t i = 0; i < per_producer; ++i )
+      {
+        while( !events->post<Sample>( p, i ) )
+        { // queue full; wait for the consumer
+          ++full;
+          this_thread::yield();
+        }
+      }
+      rejected += full;
+      running -= 1;
+    } );
+  }
+  while( running > 0 || tally.count < producers * per_producer )
+  {
+    if( events->deliver_posted() == 0 ) { this_thread::yield(); }
+  }
+  auto end = chrono::high_resolution_clock::now();
+  for( auto &t : threads ) { t.join(); }
+
+  double seconds = chrono::duration<double>( end - start ).count();
+  uint64_t total = producers * per_producer;
+  uint64_t expected_sum = producers * (per_producer * (per_producer - 1) / 2);
+  printf( "post,%d,%zu,%llu,%.4f,%.2f,%llu,%s\n", producers, capacity, (unsigned long long)total, seconds,
+          total / seconds / 1.0e6, (unsigned long long)rejected.load(), tally.sum == expected_sum ? "ok" : "MISMATCH" );
+}
+
+int main( int argc, char *argv[] )
+{
+  const uint64_t per_producer = 1000000;
+  int max_producers = max( 2u, thread::hardware_concurrency() );
+  check_nested_drain();
+  printf( "benchmark,producers,capacity,events,seconds,mevents_per_second,full_retries,check\n" );
+  for( size_t capacity : { 1024, 16384 } )
+  {
+    for( int producers = 1; producers <= max_producers; producers *= 2 )
+    {
+      run( producers, per_producer, capacity );
+    }
+  }
+  return 0;
+}
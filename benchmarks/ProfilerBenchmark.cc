@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2013 David Wicks, sansumbrella.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ Measures what a ProfileZone costs: an empty zone on one thread, and on
+ several threads writing into the same Profiler at once. Also checks that
+ the per-zone statistics cover more samples than the ring keeps, and writes
+ a small Chrome trace.
+
+ Only needs entityx and boost:
+ g++ -O2 -std=c++11 -pthread -Isrc benchmarks/ProfilerBenchmark.cc src/entityx/[A-Z]*.cc -o profiler_bench && ./profiler_bench
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <thread>
+#include <vector>
+#include "entityx/Profiler.h"
+
+using namespace entityx;
+using namespace std;
+
+double zone_ns( Profiler *profiler, uint64_t zones )
+{
+  auto start = chrono::high_resolution_clock::now();
+  for( uint64_t i = 0; i < zones; ++i )
+  {
+    ProfileZone zone( profiler, "empty" );
+  }
+  auto end = chrono::high_resolution_clock::now();
+  return chrono::duration<double, nano>( end - start ).count() / zones;
+}
+
+int main( int argc, char *argv[] )
+{
+  const uint64_t zones = 10000000;
+  auto profiler = Profiler::make();
+  printf( "benchmark,threads,zones,ns_per_zone\n" );
+  printf( "no_profiler,1,%llu,%.2f\n", (unsigned long long)zones, zone_ns( nullptr, zones ) );
+  printf( "zone,1,%llu,%.2f\n", (unsigned long long)zones, zone_ns( profiler.get(), zones ) );
+
+  // only as many threads as cores, or we'd be timing the scheduler
+  int max_threads = thread::hardware_concurrency();
+  for( int threads = 2; threads <= max_threads; threads *= 2 )
+  {
+    vector<double> ns( threads );
+    vector<thread> workers;
+    for( int t = 0; t < threads; ++t )
+    {
+      workers.emplace_back( [&, t] { ns[t] = zone_ns( profiler.get(), zones / threads ); } );
+    }
+    double worst = 0.0;
+    for( int t = 0; t < threads; ++t )
+    {
+      workers[t].join();
+      worst = max( worst, ns[t] );
+    }
+    printf( "zone,%d,%llu,%.2f\n", threads, (unsigned long long)zones, worst );
+  }
+
+  auto small = Profiler::make( 64 );
+  for( int i = 0; i < 1000; ++i )
+  {
+    small->record( "ring", i, i + 1000 );
+  }
+  auto ring = small->zones();
+  bool covered = ring.size() == 1 && ring[0].count == 1000 && small->samples().size() == 64;
+  printf( "# histogram covers the run: %s\n", covered ? "ok" : "MISMATCH" );
+
+  profiler->clear();
+  for( int frame = 0; frame < 100; ++frame )
+  {
+    ProfileZone zone( profiler.get(), "frame" );
+    this_thread::sleep_for( chrono::microseconds( frame == 99 ? 2000 : 100 ) );
+  }
+  for( auto &zone : profiler->zones() )
+  {
+    printf( "# %s: count %zu p50 %.3fms p99 %.3fms max %.3fms\n", zone.name, zone.count, zone.p50, zone.p99, zone.max );
+  }
+  ofstream trace( "profiler_bench_trace.json" );
+  profiler->write_chrome_trace( trace );
+  return 0;
+}
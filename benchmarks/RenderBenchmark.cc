@@ -0,0 +1,285 @@
+/*
+ * Copyright (c) 2013 David Wicks, sansumbrella.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ Measures RenderSystem::update, which assembles every RenderMesh into one
+ triangle strip per RenderPass, over worlds of 10k to 1M render entities.
+
+ Mixes (pick with the first argument; default runs all of them):
+   sprites    4-vertex boxes, like SpriteAnimation frames
+   shared     the same boxes drawn from one shared MeshGeometry
+   quads      the same boxes as SpriteQuads
+   circles    setAsCircle() with small radii
+   ribbons    setAsRibbon() along a 20-point skeleton
+   chained    boxes whose loci hang in parent chains four deep
+   passes     boxes spread evenly over the normal, additive and multiply passes
+   mixed      70% sprites and 10% each of circles, ribbons and chained,
+              with 10% each in the additive and multiply passes
+   level      sprites over a world ten screens wide, 90% of them stationary,
+              culled to a one-screen view
+   scenery    sprites, 90% of them stationary, all drawn
+
+ Every root locus that isn't stationary moves between frames, outside the
+ timed region, so only stationary sprites can be reused from the previous frame. Prints one CSV row per mix
+ and size: milliseconds per frame (mean and fastest), vertices per second,
+ and the bytes of vertices written per frame.
+ Pass sizes after the mix (or "all") to override the default 10000 100000 1000000.
+ Pass -j <threads> first to assemble on that many worker threads besides the caller.
+
+ Links against Cinder for math, with GL compiled out as for the headless runner:
+ g++ -O2 -std=c++11 -pthread -DPUPTENT_HEADLESS -include samples/Headless/src/Headless_Prefix.h -I$CINDER_PATH/include -I$CINDER_PATH/boost -I$POCKETS_PATH/src -Isrc benchmarks/RenderBenchmark.cc src/puptent/[A-Z]*.cpp src/entityx/[A-Z]*.cc src/entityx/tags/[A-Z]*.cc -L$CINDER_PATH/lib -lcinder -o render_bench && ./render_bench
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "cinder/Rand.h"
+#include "entityx/Entity.h"
+#include "entityx/Event.h"
+#include "entityx/System.h"
+#include "puptent/RenderSystem.h"
+
+using namespace ci;
+using namespace puptent;
+using namespace std;
+
+// how the boxes of a mix are drawn
+enum Boxes { eMeshBoxes, eSharedBoxes, eQuadBoxes };
+
+struct Mix
+{
+  const char *name;
+  // fractions of entities of each shape; sprites make up the rest
+  float circles, ribbons, chained;
+  // fractions of entities in the additive and multiply passes
+  float additive, multiply;
+  Boxes boxes;
+  // when set, the world is this many screens wide and drawn through a one-screen view
+  float screens;
+  // fraction of root entities that never move
+  float stationary;
+};
+
+const Mix mixes[] = {
+  { "sprites", 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, eMeshBoxes, 0.0f, 0.0f },
+  { "shared", 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, eSharedBoxes, 0.0f, 0.0f },
+  { "quads", 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, eQuadBoxes, 0.0f, 0.0f },
+  { "circles", 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, eMeshBoxes, 0.0f, 0.0f },
+  { "ribbons", 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, eMeshBoxes, 0.0f, 0.0f },
+  { "chained", 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, eMeshBoxes, 0.0f, 0.0f },
+  { "passes", 0.0f, 0.0f, 0.0f, 1.0f / 3.0f, 1.0f / 3.0f, eMeshBoxes, 0.0f, 0.0f },
+  { "mixed", 0.1f, 0.1f, 0.1f, 0.1f, 0.1f, eMeshBoxes, 0.0f, 0.0f },
+  { "level", 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, eMeshBoxes, 10.0f, 0.9f },
+  { "scenery", 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, eMeshBoxes, 0.0f, 0.9f }
+};
+
+const int chain_depth = 4;
+
+struct World
+{
+  EventManagerRef           events;
+  EntityManagerRef          entities;
+  SystemManagerRef          systems;
+  ptr<RenderSystem>         renderer;
+  // loci without parents; moved every frame
+  std::vector<LocusRef>     roots;
+};
+
+RenderPass choosePass( const Mix &mix, Rand &rand )
+{
+  float f = rand.nextFloat();
+  if( f < mix.additive ){ return eAdditivePass; }
+  if( f < mix.additive + mix.multiply ){ return eMultiplyPass; }
+  return eNormalPass;
+}
+
+void addEntity( World &world, const Mix &mix, Rand &rand, LocusRef parent=nullptr )
+{
+  Entity e = world.entities->create();
+  auto loc = e.assign<Locus>();
+  loc->position = parent ? Vec2f{ 10.0f, 0.0f } : Vec2f{ rand.nextFloat( 1024.0f * max( mix.screens, 1.0f ) ), rand.nextFloat( 768.0f ) };
+  loc->rotation = rand.nextFloat( M_PI * 2 );
+  loc->parent = parent;
+  bool stationary = !parent && mix.stationary > 0.0f && rand.nextFloat() < mix.stationary;
+  if( !parent && !stationary ){ world.roots.push_back( loc ); }
+
+  float shape = rand.nextFloat();
+  RenderMeshRef mesh;
+  if( mix.boxes == eQuadBoxes )
+  {
+    auto quad = e.assign<SpriteQuad>();
+    quad->size = Vec2f{ 16.0f, 16.0f };
+    quad->registration_point = Vec2f{ 8.0f, 8.0f };
+    quad->color = ColorA8u( rand.nextFloat( 255.0f ), rand.nextFloat( 255.0f ), rand.nextFloat( 255.0f ), 255 );
+    e.assign<RenderData>( quad, loc, rand.nextFloat( 50.0f ), choosePass( mix, rand ) )->stationary = stationary;
+    return;
+  }
+  if( mix.boxes == eSharedBoxes )
+  { // every sprite draws the same box
+    static const MeshGeometryRef box = [](){
+      RenderMesh mesh{ 4 };
+      mesh.setAsBox( Rectf{ -8.0f, -8.0f, 8.0f, 8.0f } );
+      return MeshGeometry::create( mesh );
+    }();
+    ColorA8u color( rand.nextFloat( 255.0f ), rand.nextFloat( 255.0f ), rand.nextFloat( 255.0f ), 255 );
+    auto data = e.assign<RenderData>( box, loc, rand.nextFloat( 50.0f ), choosePass( mix, rand ) );
+    data->color = color;
+    data->stationary = stationary;
+    return;
+  }
+  if( !parent && shape < mix.circles )
+  {
+    mesh = e.assign<RenderMesh>();
+    mesh->setAsCircle( Vec2f::one() * rand.nextFloat( 4.0f, 12.0f ) );
+  }
+  else if( !parent && shape < mix.circles + mix.ribbons )
+  {
+    mesh = e.assign<RenderMesh>();
+    vector<Vec2f> skeleton;
+    for( int i = 0; i < 20; ++i )
+    {
+      skeleton.push_back( Vec2f{ i * 5.0f, math<float>::sin( i * 0.3f ) * 10.0f } );
+    }
+    mesh->setAsRibbon( skeleton, 4.0f );
+  }
+  else
+  {
+    mesh = e.assign<RenderMesh>( 4 );
+    mesh->setAsBox( Rectf{ -8.0f, -8.0f, 8.0f, 8.0f } );
+  }
+  mesh->setColor( ColorA8u( rand.nextFloat( 255.0f ), rand.nextFloat( 255.0f ), rand.nextFloat( 255.0f ), 255 ) );
+  e.assign<RenderData>( mesh, loc, rand.nextFloat( 50.0f ), choosePass( mix, rand ) )->stationary = stationary;
+
+  if( !parent && shape >= mix.circles + mix.ribbons && shape < mix.circles + mix.ribbons + mix.chained )
+  { // hang the rest of the chain off this one
+    for( int depth = 1; depth < chain_depth; ++depth )
+    {
+      Entity child = world.entities->create();
+      auto child_loc = child.assign<Locus>();
+      child_loc->position = Vec2f{ 10.0f, 0.0f };
+      child_loc->rotation = rand.nextFloat( 1.0f );
+      child_loc->parent = loc;
+      auto child_mesh = child.assign<RenderMesh>( 4 );
+      child_mesh->setAsBox( Rectf{ -4.0f, -4.0f, 4.0f, 4.0f } );
+      child.assign<RenderData>( child_mesh, child_loc, rand.nextFloat( 50.0f ), choosePass( mix, rand ) );
+      loc = child_loc;
+    }
+  }
+}
+
+World populate( const Mix &mix, size_t count, size_t threads )
+{
+  World world;
+  world.events = EventManager::make();
+  // hand the RenderSystem all of its new entities in one batch
+  world.events->queue<ComponentAddedEvent<RenderData>>();
+  world.entities = EntityManager::make( world.events );
+  world.systems = SystemManager::make( world.entities, world.events );
+  world.renderer = world.systems->add<RenderSystem>();
+  world.renderer->setWorkerThreads( threads );
+  world.systems->configure();
+  if( mix.screens > 0.0f )
+  {
+    world.renderer->setViewRect( Rectf{ 0.0f, 0.0f, 1024.0f, 768.0f } );
+  }
+
+  Rand rand( 214 );
+  size_t created = 0;
+  while( created < count )
+  {
+    size_t before = world.entities->size();
+    addEntity( world, mix, rand );
+    created += world.entities->size() - before;
+  }
+  world.events->drain();
+  return world;
+}
+
+void run( const Mix &mix, size_t count, size_t threads )
+{
+  World world = populate( mix, count, threads );
+  const int frames = max<int>( 5, 2000000 / count );
+  double total = 0.0;
+  double fastest = 1.0e9;
+  size_t vertices = 0;
+  for( int frame = -1; frame < frames; ++frame )
+  {
+    for( auto &loc : world.roots )
+    {
+      loc->position.x += 0.5f;
+      loc->rotation += 0.01f;
+    }
+    auto start = chrono::high_resolution_clock::now();
+    world.systems->update<RenderSystem>( 1.0 / 60.0 );
+    double seconds = chrono::duration<double>( chrono::high_resolution_clock::now() - start ).count();
+    if( frame >= 0 )
+    { // the first frame grows the vertex buffers; leave it out
+      total += seconds;
+      fastest = min( fastest, seconds );
+    }
+  }
+  vertices = world.renderer->getVertices( eNormalPass ).size()
+           + world.renderer->getVertices( eAdditivePass ).size()
+           + world.renderer->getVertices( eMultiplyPass ).size();
+  double mean = total / frames;
+  printf( "%s,%zu,%zu,%d,%.3f,%.3f,%.2f,%zu\n", mix.name, world.entities->size(), vertices, frames,
+          mean * 1000.0, fastest * 1000.0, vertices / mean / 1.0e6, vertices * sizeof( Vertex ) );
+}
+
+int main( int argc, char *argv[] )
+{
+  size_t threads = 0;
+  if( argc > 2 && strcmp( argv[1], "-j" ) == 0 )
+  {
+    threads = strtoull( argv[2], nullptr, 10 );
+    argc -= 2;
+    argv += 2;
+  }
+  const char *only = argc > 1 ? argv[1] : nullptr;
+  vector<size_t> sizes;
+  for( int i = 2; i < argc; ++i )
+  {
+    sizes.push_back( strtoull( argv[i], nullptr, 10 ) );
+  }
+  if( sizes.empty() )
+  {
+    sizes = { 10000, 100000, 1000000 };
+  }
+  printf( "mix,entities,vertices,frames,mean_ms,fastest_ms,mvertices_per_second,bytes_per_frame\n" );
+  for( const auto &mix : mixes )
+  {
+    if( only && strcmp( only, "all" ) != 0 && strcmp( only, mix.name ) != 0 ){ continue; }
+    for( size_t count : sizes )
+    {
+      run( mix, count, threads );
+    }
+  }
+  return 0;
+}
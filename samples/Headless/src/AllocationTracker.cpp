@@ -0,0 +1,246 @@
+/*
+ * Copyright (c) 2013 David Wicks, sansumbrella.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "AllocationTracker.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <ostream>
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+
+using namespace puptent;
+using namespace std;
+
+namespace
+{
+  // return addresses kept per allocation, not counting operator new itself
+  const int kStackDepth = 6;
+  const size_t kMaxSites = 4096;
+
+  struct SiteSlot
+  {
+    uint64_t  key;
+    int       depth;
+    void      *stack[kStackDepth];
+    uint64_t  count;
+    uint64_t  bytes;
+    uint64_t  frames;
+    int       first_frame;
+    int       last_frame;
+  };
+
+  // plain static storage: nothing here may allocate
+  SiteSlot              sSites[kMaxSites];
+  atomic_flag           sSitesLock = ATOMIC_FLAG_INIT;
+  atomic<bool>          sTracking( false );
+  atomic<int>           sFrame( 0 );
+  atomic<uint64_t>      sCount( 0 );
+  atomic<uint64_t>      sBytes( 0 );
+  thread_local bool     tInsideHook = false;
+
+  // never inlined, so the stack always starts with record(), allocate() and operator new
+  __attribute__((noinline)) void record( size_t size )
+  {
+    const int skipped = 3;
+    void *frames[kStackDepth + skipped];
+    int depth = backtrace( frames, kStackDepth + skipped );
+    void **stack = frames + skipped;
+    depth = max( 0, depth - skipped );
+    uint64_t key = 14695981039346656037ULL;
+    for( int i = 0; i < depth; ++i )
+    {
+      key = ( key ^ reinterpret_cast<uintptr_t>( stack[i] ) ) * 1099511628211ULL;
+    }
+    key |= 1; // zero marks an empty slot
+    int frame = sFrame.load( memory_order_relaxed );
+    sCount.fetch_add( 1, memory_order_relaxed );
+    sBytes.fetch_add( size, memory_order_relaxed );
+
+    while( sSitesLock.test_and_set( memory_order_acquire ) ){}
+    for( size_t probe = 0; probe < kMaxSites; ++probe )
+    {
+      SiteSlot &slot = sSites[( key + probe ) % kMaxSites];
+      if( slot.key == 0 )
+      {
+        slot.key = key;
+        slot.depth = depth;
+        copy( stack, stack + depth, slot.stack );
+        slot.first_frame = frame;
+        slot.last_frame = frame - 1;
+      }
+      if( slot.key == key )
+      {
+        slot.count += 1;
+        slot.bytes += size;
+        if( slot.last_frame != frame )
+        {
+          slot.frames += 1;
+          slot.last_frame = frame;
+        }
+        break;
+      }
+    }
+    sSitesLock.clear( memory_order_release );
+  }
+
+  __attribute__((noinline)) void* allocate( size_t size )
+  {
+    void *ptr = malloc( size ? size : 1 );
+    if( sTracking.load( memory_order_relaxed ) && !tInsideHook )
+    {
+      tInsideHook = true;
+      record( size );
+      tInsideHook = false;
+    }
+    return ptr;
+  }
+}
+
+void* operator new( size_t size )
+{
+  void *ptr = allocate( size );
+  if( !ptr ){ throw bad_alloc(); }
+  return ptr;
+}
+
+void* operator new[]( size_t size )
+{
+  void *ptr = allocate( size );
+  if( !ptr ){ throw bad_alloc(); }
+  return ptr;
+}
+
+void* operator new( size_t size, const nothrow_t& ) noexcept { return allocate( size ); }
+void* operator new[]( size_t size, const nothrow_t& ) noexcept { return allocate( size ); }
+void operator delete( void *ptr ) noexcept { free( ptr ); }
+void operator delete[]( void *ptr ) noexcept { free( ptr ); }
+void operator delete( void *ptr, const nothrow_t& ) noexcept { free( ptr ); }
+void operator delete[]( void *ptr, const nothrow_t& ) noexcept { free( ptr ); }
+
+void AllocationTracker::setTracking( bool tracking )
+{
+  if( tracking )
+  { // backtrace() loads its unwinder on first use; do that outside of any count
+    void *frames[1];
+    backtrace( frames, 1 );
+  }
+  sTracking = tracking;
+}
+
+void AllocationTracker::setFrame( int frame )
+{
+  sFrame = frame;
+}
+
+uint64_t AllocationTracker::getCount()
+{
+  return sCount;
+}
+
+uint64_t AllocationTracker::getBytes()
+{
+  return sBytes;
+}
+
+void AllocationTracker::resetCounts()
+{
+  sCount = 0;
+  sBytes = 0;
+}
+
+void AllocationTracker::clearSites()
+{
+  while( sSitesLock.test_and_set( memory_order_acquire ) ){}
+  memset( sSites, 0, sizeof( sSites ) );
+  sSitesLock.clear( memory_order_release );
+}
+
+vector<AllocationTracker::Site> AllocationTracker::getSites()
+{
+  bool tracking = sTracking.exchange( false );
+  vector<Site> sites;
+  while( sSitesLock.test_and_set( memory_order_acquire ) ){}
+  for( const auto &slot : sSites )
+  {
+    if( slot.key != 0 )
+    {
+      sites.push_back( Site{ vector<void*>( slot.stack, slot.stack + slot.depth ), slot.count, slot.bytes, slot.frames, slot.first_frame, slot.last_frame } );
+    }
+  }
+  sSitesLock.clear( memory_order_release );
+  sTracking = tracking;
+  sort( sites.begin(), sites.end(), []( const Site &a, const Site &b ){ return a.count > b.count; } );
+  return sites;
+}
+
+string AllocationTracker::describe( const vector<void*> &stack )
+{
+  string description;
+  for( void *address : stack )
+  {
+    Dl_info info;
+    string name;
+    if( dladdr( address, &info ) && info.dli_sname )
+    {
+      int status = 0;
+      char *demangled = abi::__cxa_demangle( info.dli_sname, nullptr, nullptr, &status );
+      name = status == 0 ? demangled : info.dli_sname;
+      free( demangled );
+    }
+    else
+    { // unexported; module and offset are enough for addr2line or atos
+      char offset[64];
+      uintptr_t base = dladdr( address, &info ) ? reinterpret_cast<uintptr_t>( info.dli_fbase ) : 0;
+      snprintf( offset, sizeof( offset ), "+0x%llx", (unsigned long long)( reinterpret_cast<uintptr_t>( address ) - base ) );
+      name = ( base && info.dli_fname ? string( info.dli_fname ) : "?" ) + offset;
+    }
+    if( !description.empty() ){ description += " < "; }
+    description += name;
+  }
+  return description;
+}
+
+void AllocationTracker::writeSites( ostream &out, size_t max_sites )
+{
+  bool tracking = sTracking.exchange( false );
+  out << "site,count,bytes,frames,first_frame,last_frame\n";
+  auto sites = getSites();
+  sites.resize( min( sites.size(), max_sites ) );
+  for( const auto &site : sites )
+  {
+    string name = describe( site.stack );
+    replace( name.begin(), name.end(), '"', '\'' );
+    out << '"' << name << "\"," << site.count << ',' << site.bytes << ',' << site.frames << ','
+        << site.first_frame << ',' << site.last_frame << '\n';
+  }
+  sTracking = tracking;
+}
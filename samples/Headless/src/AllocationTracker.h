@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2013 David Wicks, sansumbrella.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace puptent
+{
+  /**
+   AllocationTracker:
+   Counts every global operator new while tracking is on, by call site.
+   For finding per-frame heap allocations in a steady-state simulation.
+
+   Linking AllocationTracker.cpp replaces the global operator new and delete,
+   so only link it into test and benchmark programs, like HeadlessRunner.
+   Call sites are the first few return addresses above operator new;
+   writeSites() symbolizes them. Link with -rdynamic to get names for
+   functions that aren't exported.
+
+   Counts cover every thread. Frame numbers are whatever you pass to setFrame().
+   */
+  class AllocationTracker
+  {
+  public:
+    struct Site
+    {
+      std::vector<void*>  stack;
+      uint64_t            count;
+      uint64_t            bytes;
+      //! how many distinct frames allocated here, and the first and last of them
+      uint64_t            frames;
+      int                 first_frame;
+      int                 last_frame;
+    };
+    //! turn counting on or off
+    static void     setTracking( bool tracking );
+    //! allocations are attributed to \a frame until the next call
+    static void     setFrame( int frame );
+    //! allocations and bytes since the last resetCounts()
+    static uint64_t getCount();
+    static uint64_t getBytes();
+    static void     resetCounts();
+    //! forget every call site seen so far, eg. once warm-up is over
+    static void     clearSites();
+    //! every call site seen while tracking, most allocations first
+    static std::vector<Site> getSites();
+    //! write the busiest sites as CSV: site,count,bytes,frames,first_frame,last_frame
+    static void     writeSites( std::ostream &out, size_t max_sites = 50 );
+    //! readable description of a call stack, innermost first
+    static std::string describe( const std::vector<void*> &stack );
+  };
+} // puptent::
@@ -0,0 +1,305 @@
+/*
+ * Copyright (c) 2013 David Wicks, sansumbrella.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ Steps a Scenario as fast as possible with no window or GL context, for
+ profiling and benchmarking on machines without a GPU.
+
+ Runs every system the sample app does, including RenderSystem::update,
+ which assembles the vertex batches; only RenderSystem::draw is skipped.
+ Each frame is one fixed step. Prints a summary and per-zone timings as CSV:
+ frame time percentiles leave out the warm-up frames, and each system's
+ update is a zone, so the zones break a frame down by system.
+
+ The stress-*.json scenarios in assets load the engine far more heavily than
+ the sample app does; track their frames_per_second and p99_ms for
+ end-to-end throughput:
+   for s in assets/stress-*.json; do ./headless $s; done
+ Scenarios with a view_width and view_height cull to that view; the summary's
+ drawn and culled columns count render data in the last frame.
+
+ Usage: HeadlessRunner [options] [scenario.json] [frames]
+   scenario             defaults to assets/default.json, or the recording's when replaying
+   frames               overrides the scenario's frame count
+   --replay <file>      play back the dt, input and random seeds of a recording,
+                        eg. one made by the sample app's --record, and check the
+                        world hash after every frame against the recorded one
+   --record <file>      record this run; ships are then steered by (no) input
+   --frame-log <file>   write each frame's dt, update time and world hash as CSV
+   --trace <file>       write a Chrome trace of the run (open in chrome://tracing)
+   --allocations <file> count heap allocations made while updating, per frame and
+                        by call site (sites seen after warm-up only) as CSV
+   --warm-up <frames>   frames before the steady state begins, left out of the
+                        percentiles and allocation checks; defaults to 60
+   --assert-no-allocations
+                        fail if any frame after warm-up allocates, listing the call sites
+
+ Built by the Makefile alongside, which defines PUPTENT_HEADLESS to compile
+ out window input, GL textures and RenderSystem::draw, and links against
+ Cinder for math and json only:
+   make CINDER_PATH=/path/to/cinder && ./headless assets/default.json
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "cinder/DataSource.h"
+#include "cinder/Json.h"
+#include "cinder/Rand.h"
+
+#include "entityx/Event.h"
+#include "entityx/Entity.h"
+#include "entityx/System.h"
+#include "entityx/Profiler.h"
+
+#include "puptent/RenderSystem.h"
+#include "puptent/TextureAtlas.h"
+#include "puptent/SpriteSystem.h"
+#include "puptent/ParticleSystem.h"
+#include "puptent/ExpiresSystem.h"
+#include "puptent/ScriptSystem.h"
+#include "puptent/KeyboardInput.h"
+#include "puptent/Recording.h"
+#include "puptent/Scenario.h"
+#include "AllocationTracker.h"
+
+using namespace ci;
+using namespace std;
+using namespace puptent;
+
+int main( int argc, char *argv[] )
+{
+  const char *scenario_arg = nullptr;
+  const char *frames_arg = nullptr;
+  const char *replay_path = nullptr;
+  const char *record_path = nullptr;
+  const char *frame_log_path = nullptr;
+  const char *trace_path = nullptr;
+  const char *allocations_path = nullptr;
+  int warm_up = 60;
+  bool assert_no_allocations = false;
+  for( int i = 1; i < argc; ++i )
+  {
+    bool has_value = i + 1 < argc;
+    if( has_value && strcmp( argv[i], "--replay" ) == 0 ){ replay_path = argv[++i]; }
+    else if( has_value && strcmp( argv[i], "--record" ) == 0 ){ record_path = argv[++i]; }
+    else if( has_value && strcmp( argv[i], "--frame-log" ) == 0 ){ frame_log_path = argv[++i]; }
+    else if( has_value && strcmp( argv[i], "--trace" ) == 0 ){ trace_path = argv[++i]; }
+    else if( has_value && strcmp( argv[i], "--allocations" ) == 0 ){ allocations_path = argv[++i]; }
+    else if( has_value && strcmp( argv[i], "--warm-up" ) == 0 ){ warm_up = atoi( argv[++i] ); }
+    else if( strcmp( argv[i], "--assert-no-allocations" ) == 0 ){ assert_no_allocations = true; }
+    else if( !scenario_arg ){ scenario_arg = argv[i]; }
+    else { frames_arg = argv[i]; }
+  }
+
+  unique_ptr<Recording> replay;
+  if( replay_path )
+  {
+    replay.reset( new Recording( replay_path ) );
+  }
+  string scenario_path = scenario_arg ? scenario_arg : ( replay ? replay->getScenario() : "assets/default.json" );
+  Scenario scenario{ scenario_path };
+  if( replay )
+  {
+    scenario.frames = replay->frames().size();
+  }
+  if( frames_arg )
+  {
+    scenario.frames = atoi( frames_arg );
+  }
+  if( replay && scenario.frames > static_cast<int>( replay->frames().size() ) )
+  {
+    scenario.frames = replay->frames().size();
+  }
+
+  TextureAtlasRef atlas = TextureAtlas::create( JsonTree( loadFile( scenario.atlas ) ) );
+  JsonTree animations{ loadFile( scenario.animations ) };
+
+  // the sample app's world, minus the texture
+  auto events = EventManager::make();
+  events->queue<EntityDestroyedEvent>();
+  auto entities = EntityManager::make( events );
+  auto systems = SystemManager::make( entities, events );
+  systems->set_worker_threads( max( 1u, thread::hardware_concurrency() ) - 1 );
+  systems->add<LocusHistorySystem>();
+  systems->add<ExpiresSystem>();
+  systems->add<ScriptSystem>();
+  auto sprites = systems->add<SpriteAnimationSystem>( atlas, animations );
+  systems->add<ParticleSystem>();
+  auto renderer = systems->add<RenderSystem>();
+  renderer->setWorkerThreads( max( 1u, thread::hardware_concurrency() ) - 1 );
+  if( scenario.view.x > 0.0f && scenario.view.y > 0.0f )
+  {
+    renderer->setViewRect( Rectf{ Vec2f::zero(), scenario.view } );
+  }
+  auto profiler = Profiler::make();
+  systems->set_profiler( profiler );
+  systems->configure();
+  systems->set_fixed_step( scenario.step, 4 );
+  systems->set_per_frame<RenderSystem>();
+  systems->set_slices<ExpiresSystem>( 4 );
+
+  // recorded runs steer their ships by keyboard, as the sample app does
+  KeyboardInputRef input;
+  if( replay || record_path )
+  {
+    input = KeyboardInput::create();
+  }
+  scenario.populate( entities, sprites, input );
+  size_t initial_entities = entities->size();
+
+  Recording recording;
+  recording.setScenario( scenario_path );
+  ofstream frame_log;
+  if( frame_log_path )
+  {
+    frame_log.open( frame_log_path );
+    frame_log << "frame,dt,update_ms,hash,recorded_hash\n";
+  }
+  bool hashing = replay || record_path || frame_log_path;
+  int mismatches = 0;
+  int first_mismatch = -1;
+  double total_ms = 0.0;
+  vector<double> frame_ms( scenario.frames );
+  bool tracking = allocations_path || assert_no_allocations;
+  // allocations and bytes of each frame; sized up front so recording them doesn't allocate
+  vector<pair<uint64_t, uint64_t>> frame_allocations( tracking ? scenario.frames : 0 );
+
+  for( int frame = 0; frame < scenario.frames; ++frame )
+  {
+    const FrameRecord *recorded = replay ? &replay->frames()[frame] : nullptr;
+    double dt = recorded ? recorded->dt : scenario.step;
+    if( recorded )
+    {
+      Rand::randSeed( recorded->seed );
+      for( int key : recorded->keys_down ){ input->queueKeyDown( key ); }
+      for( int key : recorded->keys_up ){ input->queueKeyUp( key ); }
+    }
+    else if( record_path )
+    {
+      recording.beginFrame( dt );
+    }
+    if( input )
+    {
+      input->update();
+    }
+
+    if( tracking )
+    {
+      if( frame == warm_up ){ AllocationTracker::clearSites(); }
+      AllocationTracker::setFrame( frame );
+      AllocationTracker::resetCounts();
+      AllocationTracker::setTracking( true );
+    }
+    auto start = profiler->now();
+    {
+      ProfileZone zone( profiler.get(), "HeadlessRunner::frame" );
+      systems->update_frame( dt );
+      events->end_frame();
+    }
+    double update_ms = ( profiler->now() - start ) / 1.0e6;
+    if( tracking )
+    {
+      AllocationTracker::setTracking( false );
+      frame_allocations[frame] = { AllocationTracker::getCount(), AllocationTracker::getBytes() };
+    }
+    total_ms += update_ms;
+    frame_ms[frame] = update_ms;
+
+    if( !hashing ){ continue; }
+    uint64_t hash = worldHash( entities );
+    if( record_path )
+    {
+      recording.endFrame( input->getLastKeysDown(), input->getLastKeysUp(), hash );
+    }
+    if( recorded && recorded->hash && recorded->hash != hash )
+    {
+      mismatches += 1;
+      if( first_mismatch < 0 ){ first_mismatch = frame; }
+    }
+    if( frame_log )
+    {
+      char line[128];
+      snprintf( line, sizeof( line ), "%d,%.9g,%.4f,%016llx,%016llx\n", frame, dt, update_ms,
+               (unsigned long long)hash, (unsigned long long)( recorded ? recorded->hash : 0 ) );
+      frame_log << line;
+    }
+  }
+
+  // steady-state frame times; every frame if the run is no longer than the warm-up
+  vector<double> steady( frame_ms.begin() + ( warm_up < scenario.frames ? max( warm_up, 0 ) : 0 ), frame_ms.end() );
+  sort( steady.begin(), steady.end() );
+  auto percentile = [&steady]( double p ) {
+    return steady.empty() ? 0.0 : steady[static_cast<size_t>( ( steady.size() - 1 ) * p )];
+  };
+  printf( "scenario,frames,initial_entities,final_entities,total_ms,frames_per_second,p50_ms,p90_ms,p99_ms,max_ms,hash_mismatches,first_mismatch,drawn,culled\n" );
+  printf( "\"%s\",%d,%zu,%zu,%.3f,%.1f,%.3f,%.3f,%.3f,%.3f,%d,%d,%zu,%zu\n", scenario_path.c_str(), scenario.frames,
+          initial_entities, entities->size(), total_ms, scenario.frames / ( total_ms / 1000.0 ),
+          percentile( 0.5 ), percentile( 0.9 ), percentile( 0.99 ), percentile( 1.0 ), mismatches, first_mismatch,
+          renderer->getDrawnCount(), renderer->getCulledCount() );
+  profiler->write_zones_csv( cout );
+
+  if( record_path )
+  {
+    recording.save( record_path );
+  }
+  if( trace_path )
+  {
+    ofstream trace( trace_path );
+    profiler->write_chrome_trace( trace );
+  }
+  int allocating_frames = 0;
+  for( int frame = warm_up; frame < static_cast<int>( frame_allocations.size() ); ++frame )
+  {
+    allocating_frames += frame_allocations[frame].first > 0;
+  }
+  if( allocations_path )
+  {
+    ofstream out( allocations_path );
+    out << "frame,allocations,bytes\n";
+    for( size_t frame = 0; frame < frame_allocations.size(); ++frame )
+    {
+      out << frame << ',' << frame_allocations[frame].first << ',' << frame_allocations[frame].second << '\n';
+    }
+    out << '\n';
+    AllocationTracker::writeSites( out );
+  }
+  if( assert_no_allocations && allocating_frames > 0 )
+  {
+    cerr << allocating_frames << " frames allocated after warm-up, at:" << endl;
+    AllocationTracker::writeSites( cerr );
+    return 2;
+  }
+  return mismatches == 0 ? 0 : 1;
+}
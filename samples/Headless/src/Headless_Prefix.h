@@ -0,0 +1,15 @@
+// Included before every source of the headless runner, in place of the
+// sample app's prefix header, which pulls in the app and GL headers.
+#if defined( __cplusplus )
+	#include "cinder/Cinder.h"
+
+	#include "cinder/app/KeyEvent.h"
+
+	#include "cinder/CinderMath.h"
+	#include "cinder/Color.h"
+	#include "cinder/Filesystem.h"
+	#include "cinder/Json.h"
+	#include "cinder/Matrix.h"
+	#include "cinder/Rect.h"
+	#include "cinder/Vector.h"
+#endif
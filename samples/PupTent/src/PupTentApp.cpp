@@ -4,10 +4,13 @@
 #include "cinder/Json.h"
 #include "cinder/ip/Premultiply.h"
 #include "cinder/Easing.h"
+#include "cinder/Utilities.h"
+#include <fstream>
 
 #include "entityx/Event.h"
 #include "entityx/Entity.h"
 #include "entityx/System.h"
+#include "entityx/Profiler.h"
 #include "entityx/tags/TagsComponent.h"
 
 #include "pockets/AnimationUtils.h"
@@ -16,9 +19,12 @@
 #include "puptent/TextureAtlas.h"
 #include "puptent/SpriteSystem.h"
 #include "puptent/ParticleSystem.h"
+#include "puptent/PathSystem.h"
 #include "puptent/ExpiresSystem.h"
 #include "puptent/ScriptSystem.h"
 #include "puptent/ParticleBehaviorSystems.h"
+#include "puptent/Recording.h"
+#include "puptent/Scenario.h"
 #include "KeyboardInput.h"
 
 /**
@@ -40,6 +46,7 @@ public:
 	void setup();
 	void update() override;
 	void draw() override;
+  void shutdown() override;
   Entity createPlayer();
   Entity createTreasure();
   Entity createRibbon();
@@ -51,8 +58,11 @@ private:
   shared_ptr<EntityManager> mEntities;
   shared_ptr<SystemManager> mSystemManager;
   SpriteAnimationSystemRef  mSpriteSystem;
-  double                    mAverageUpdateTime = 1.0;
-  double                    mAverageRenderTime = 1.0;
+  shared_ptr<Profiler>      mProfiler;
+  // set with --record <file>; see samples/Headless to replay
+  unique_ptr<Recording>     mRecording;
+  fs::path                  mRecordingPath;
+  KeyboardInputRef          mInput;
   Timer                     mTimer;
   TextureAtlas              mTextureAtlas;
 };
@@ -77,15 +87,50 @@ void PupTentApp::setup()
 
   // Set up entity manager and systems
   mEvents = EventManager::make();
+  // deliver entity destruction in one batch per step, after the simulation systems have run
+  mEvents->queue<EntityDestroyedEvent>();
   mEntities = EntityManager::make(mEvents);
   mSystemManager = SystemManager::make( mEntities, mEvents );
+  mSystemManager->set_worker_threads( max( 1u, thread::hardware_concurrency() ) - 1 );
+  // systems update in the order added, except where their declared access lets them overlap
+  mSystemManager->add<LocusHistorySystem>();
   mSystemManager->add<ExpiresSystem>();
-  mSystemManager->add<ParticleSystem>();
   mSystemManager->add<ScriptSystem>();
   mSpriteSystem = mSystemManager->add<SpriteAnimationSystem>( atlas, animations );
+  mSystemManager->add<ParticleSystem>();
+  mSystemManager->add<PathSystem>();
   auto renderer = mSystemManager->add<RenderSystem>();
   renderer->setTexture( atlas->getTexture() );
+  // rendering runs once the simulation is done, so it can spread vertex assembly over every core
+  renderer->setWorkerThreads( max( 1u, thread::hardware_concurrency() ) - 1 );
+  mProfiler = Profiler::make();
+  mSystemManager->set_profiler( mProfiler );
   mSystemManager->configure();
+  // simulate at a steady 60Hz; render once per frame, interpolating between steps
+  mSystemManager->set_fixed_step( 1.0 / 60.0, 4 );
+  mSystemManager->set_per_frame<RenderSystem>();
+  // expiry doesn't need checking every step; spread it over four
+  mSystemManager->set_slices<ExpiresSystem>( 4 );
+
+  // --record <file> [--scenario <file>]: build the world from a scenario
+  // and record the run, so the headless runner can replay it exactly
+  const auto &args = getArgs();
+  fs::path scenario_path = getAssetPath( "scenario.json" );
+  for( size_t i = 1; i + 1 < args.size(); ++i )
+  {
+    if( args[i] == "--record" ){ mRecordingPath = args[i + 1]; }
+    if( args[i] == "--scenario" ){ scenario_path = args[i + 1]; }
+  }
+  if( !mRecordingPath.empty() )
+  {
+    mRecording.reset( new Recording );
+    mRecording->setScenario( scenario_path.string() );
+    mInput = KeyboardInput::create();
+    mInput->connect( getWindow() );
+    Scenario( scenario_path ).populate( mEntities, mSpriteSystem, mInput );
+    mTimer.start();
+    return;
+  }
 
   createPlayer();
   for( int i = 0; i < 1000; ++i )
@@ -115,6 +160,24 @@ Entity PupTentApp::createPlanet()
   planet.assign<RenderData>( mesh, loc, 0 );
   loc->position = Vec2f{ 200.0f, 400.0f };
 
+  Entity orbit = mEntities->create();
+  { // an orbit line around the planet, as four cubic arcs
+    auto locus = orbit.assign<Locus>();
+    locus->parent = loc;
+    float r = planet_size * 1.4f;
+    float k = r * 0.5523f;
+    auto path = orbit.assign<PathComponent>( 3.0f, eRoundJoin );
+    path->moveTo( Vec2f{ r, 0.0f } );
+    path->curveTo( Vec2f{ r, k }, Vec2f{ k, r }, Vec2f{ 0.0f, r } );
+    path->curveTo( Vec2f{ -k, r }, Vec2f{ -r, k }, Vec2f{ -r, 0.0f } );
+    path->curveTo( Vec2f{ -r, -k }, Vec2f{ -k, -r }, Vec2f{ 0.0f, -r } );
+    path->curveTo( Vec2f{ k, -r }, Vec2f{ r, -k }, Vec2f{ r, 0.0f } );
+    path->setClosed();
+    path->setColor( Color::gray( 0.5f ) );
+    auto mesh = orbit.assign<RenderMesh>();
+    orbit.assign<RenderData>( mesh, locus, 0 );
+  }
+
   for( int i = 0; i < 10; ++i )
   {
     // compound shape setup to avoid entity explosion?
@@ -176,18 +239,11 @@ Entity PupTentApp::createShip()
   Entity trailing_ribbon = mEntities->create();
   { // smoke trail or something (use ship locus directly to plot path)
     auto locus = trailing_ribbon.assign<Locus>();
-    std::deque<Vec2f> ribbon_vertices;
-    ribbon_vertices.assign( 11, loc->toMatrix().transformPoint( { 0.0f, 40.0f } ) );
-    auto mesh = trailing_ribbon.assign<RenderMesh>( 20 );
-    trailing_ribbon.assign<RenderData>( mesh, locus, 4 );
-    trailing_ribbon.assign<CppScriptComponent>([=]( Entity self, double dt ) mutable
-                                            { // use the ship locus to update out vertices
-                                              auto locus = self.component<Locus>();
-                                              auto front = loc->toMatrix().transformPoint( { 0.0f, 40.0f } );
-                                              ribbon_vertices.emplace_front( front );
-                                              ribbon_vertices.pop_back();
-                                              auto mesh = self.component<RenderMesh>();
-                                              mesh->setAsRibbon( ribbon_vertices, 4.0f );
+    auto ribbon = trailing_ribbon.assign<RibbonTrail>( 11, loc->toMatrix().transformPoint( { 0.0f, 40.0f } ), 4.0f );
+    trailing_ribbon.assign<RenderData>( ribbon, locus, 4 );
+    trailing_ribbon.assign<CppScriptComponent>([=]( Entity self, double dt )
+                                            { // use the ship locus to extend the trail
+                                              ribbon->push( loc->toMatrix().transformPoint( { 0.0f, 40.0f } ) );
                                             } );
   }
 
@@ -204,7 +260,8 @@ Entity PupTentApp::createShip()
                                    locus->rotation = wrapLerp( locus->rotation, (float)M_PI * 0.5f + math<float>::atan2( delta.y, delta.x ), (float)M_PI * 2, 0.2f );
                                  }
 
-                                 if( input->getKeyPressed( KeyEvent::KEY_d ) )
+                                 // take the press so it breaks the wings off exactly once, however many steps this frame runs
+                                 if( input->takeKeyPressed( KeyEvent::KEY_d ) && left_wing.valid() && left_wing.component<Locus>()->parent )
                                  {
                                    // break off children
                                    auto l_loc = left_wing.component<Locus>();
@@ -329,34 +386,47 @@ void PupTentApp::update()
 {
   double dt = mTimer.getSeconds();
   mTimer.start();
-  Timer up;
-  up.start();
-  mSystemManager->update<ExpiresSystem>( dt );
-  mSystemManager->update<ScriptSystem>( dt );
-  mSystemManager->update<SpriteAnimationSystem>( dt );
-  mSystemManager->update<ParticleSystem>( dt );
-  mSystemManager->update<RenderSystem>( dt );
-  double ms = up.getSeconds() * 1000;
-  mAverageUpdateTime = (mAverageUpdateTime * 59.0 + ms) / 60.0;
+  if( mRecording )
+  {
+    mRecording->beginFrame( dt );
+  }
+  mSystemManager->update_frame( dt );
+  if( mRecording )
+  { // our input updated itself at the start of this frame
+    mRecording->endFrame( mInput->getLastKeysDown(), mInput->getLastKeysUp(), worldHash( mEntities ) );
+  }
   if( getElapsedFrames() % 90 == 0 )
   {
-    cout << "Update: " << mAverageUpdateTime << ", " << ms << endl;
+    mProfiler->write_zones_csv( cout );
+#ifdef ENTITYX_INSTRUMENT_EVENTS
+    mEvents->write_stats_csv( cout );
+#endif
+#ifdef ENTITYX_VALIDATE_SYSTEM_ACCESS
+    for( auto &violation : mSystemManager->access_violations() )
+    {
+      cout << "Undeclared access: " << violation << endl;
+    }
+#endif
   }
+  mEvents->end_frame();
 }
 
 void PupTentApp::draw()
 {
 	gl::clear( Color::black() );
   gl::color( Color::white() );
-  Timer dr;
-  dr.start();
+  ProfileZone zone( mProfiler.get(), "RenderSystem::draw" );
   //  mSystemManager->system<PhysicsSystem>()->debugDraw();
   mSystemManager->system<RenderSystem>()->draw();
-  double ms = dr.getSeconds() * 1000;
-  mAverageRenderTime = (mAverageRenderTime * 59.0 + ms) / 60.0;
-  if( getElapsedFrames() % 90 == 0 )
+}
+
+void PupTentApp::shutdown()
+{ // open in chrome://tracing
+  ofstream trace( (getHomeDirectory() / "puptent_trace.json").string() );
+  mProfiler->write_chrome_trace( trace );
+  if( mRecording )
   {
-    cout << "Render: " << mAverageRenderTime << ", " << ms << endl;
+    mRecording->save( mRecordingPath );
   }
 }
 
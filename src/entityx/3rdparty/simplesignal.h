@@ -201,6 +201,8 @@ public:
   size ()
   {
     int size = 0;
+    if (!callback_ring_)
+      return size;
     SignalLink *link = callback_ring_;
     link->incref();
     do
@@ -215,6 +217,7 @@ public:
         old->decref();
       }
     while (link != callback_ring_);
+    link->decref();
     return size;
   }
 };
@@ -25,6 +25,7 @@
 
 #include "entityx/config.h"
 #include "entityx/Event.h"
+#include "entityx/SystemAccess.h"
 
 namespace entityx {
 
@@ -152,6 +153,11 @@ inline std::ostream &operator << (std::ostream &out, const Entity &entity) {
 }
 
 
+inline EventFilter EventFilter::entity(const Entity &entity) {
+  return EventFilter::entity(entity.id().id());
+}
+
+
 /**
  * Base component class, only used for insertion into collections.
  *
@@ -241,7 +247,7 @@ struct ComponentRemovedEvent : public Event<ComponentRemovedEvent<T>> {
  */
 class EntityManager : boost::noncopyable, public enable_shared_from_this<EntityManager> {
  public:
-  typedef std::bitset<entityx::MAX_COMPONENTS> ComponentMask;
+  typedef entityx::ComponentMask ComponentMask;
 
   explicit EntityManager(ptr<EventManager> event_manager);
   virtual ~EntityManager();
@@ -399,6 +405,9 @@ class EntityManager : boost::noncopyable, public enable_shared_from_this<EntityM
    * Emits EntityCreatedEvent.
    */
   Entity create() {
+#ifdef ENTITYX_VALIDATE_SYSTEM_ACCESS
+    SystemAccess::check_structure();
+#endif
     uint32_t index, version;
     if (free_list_.empty()) {
       index = index_counter_++;
@@ -422,13 +431,17 @@ class EntityManager : boost::noncopyable, public enable_shared_from_this<EntityM
   void destroy(Entity::Id entity) {
     assert(entity.index() < entity_component_mask_.size() && "Entity::Id ID outside entity vector range");
     assert(entity_version_[entity.index()] == entity.version() && "Attempt to destroy Entity using a stale Entity::Id");
-    event_manager_->emit<EntityDestroyedEvent>(Entity(shared_from_this(), entity));
+#ifdef ENTITYX_VALIDATE_SYSTEM_ACCESS
+    SystemAccess::check_structure();
+#endif
+    event_manager_->emit_routed<EntityDestroyedEvent>(route(entity), Entity(shared_from_this(), entity));
     for (auto &components : entity_components_) {
       components[entity.index()].reset();
     }
     entity_component_mask_[entity.index()] = 0;
     entity_version_[entity.index()]++;
     free_list_.push_back(entity.index());
+    event_manager_->forget_entity(entity.id());
   }
 
   Entity get(Entity::Id id) {
@@ -453,12 +466,15 @@ class EntityManager : boost::noncopyable, public enable_shared_from_this<EntityM
    */
   template <typename C>
   ptr<C> assign(Entity::Id id, ptr<C> component) {
+#ifdef ENTITYX_VALIDATE_SYSTEM_ACCESS
+    SystemAccess::check_structure();
+#endif
     ptr<BaseComponent> base(static_pointer_cast<BaseComponent>(component));
     accomodate_component(C::family());
     entity_components_[C::family()][id.index()] = base;
     entity_component_mask_[id.index()] |= uint64_t(1) << C::family();
 
-    event_manager_->emit<ComponentAddedEvent<C>>(Entity(shared_from_this(), id), component);
+    event_manager_->emit_routed<ComponentAddedEvent<C>>(route(id), Entity(shared_from_this(), id), component);
     return component;
   }
 
@@ -481,11 +497,16 @@ class EntityManager : boost::noncopyable, public enable_shared_from_this<EntityM
    */
   template <typename C>
   ptr<C> remove(const Entity::Id &id) {
+#ifdef ENTITYX_VALIDATE_SYSTEM_ACCESS
+    SystemAccess::check_structure();
+#endif
     ptr<C> component(static_pointer_cast<C>(entity_components_[C::family()][id.index()]));
+    // Route with the mask from before removal, so filters on C still match.
+    EventRoute before = route(id);
     entity_components_[C::family()][id.index()].reset();
     entity_component_mask_[id.index()] &= ~(uint64_t(1) << C::family());
     if (component)
-      event_manager_->emit<ComponentRemovedEvent<C>>(Entity(shared_from_this(), id), component);
+      event_manager_->emit_routed<ComponentRemovedEvent<C>>(before, Entity(shared_from_this(), id), component);
     return component;
   }
 
@@ -496,6 +517,9 @@ class EntityManager : boost::noncopyable, public enable_shared_from_this<EntityM
    */
   template <typename C>
   ptr<C> component(const Entity::Id &id) {
+#ifdef ENTITYX_VALIDATE_SYSTEM_ACCESS
+    SystemAccess::check_read<C>();
+#endif
     // We don't bother checking the component mask, as we return a nullptr anyway.
     if (C::family() >= entity_components_.size()) {
       return ptr<C>();
@@ -509,6 +533,9 @@ class EntityManager : boost::noncopyable, public enable_shared_from_this<EntityM
    */
   template <typename C, typename ... Components>
   View entities_with_components() {
+#ifdef ENTITYX_VALIDATE_SYSTEM_ACCESS
+    check_reads<C, Components ...>();
+#endif
     auto mask = component_mask<C, Components ...>();
     return View(shared_from_this(), View::ComponentMaskPredicate(entity_component_mask_, mask));
   }
@@ -518,6 +545,9 @@ class EntityManager : boost::noncopyable, public enable_shared_from_this<EntityM
    */
   template <typename C, typename ... Components>
   View entities_with_components(ptr<C> &c, Components && ... args) {
+#ifdef ENTITYX_VALIDATE_SYSTEM_ACCESS
+    check_reads<C, typename std::remove_reference<Components>::type::element_type ...>();
+#endif
     auto mask = component_mask(c, args ...);
     return
         View(shared_from_this(), View::ComponentMaskPredicate(entity_component_mask_, mask))
@@ -585,6 +615,18 @@ class EntityManager : boost::noncopyable, public enable_shared_from_this<EntityM
     return component_mask<C1>(c1) | component_mask<C2, Components ...>(c2, args...);
   }
 
+#ifdef ENTITYX_VALIDATE_SYSTEM_ACCESS
+  template <typename ... Components>
+  static void check_reads() {
+    int checks[] = { (SystemAccess::check_read<Components>(), 0) ... };
+    (void)checks;
+  }
+#endif
+
+  EventRoute route(Entity::Id id) const {
+    return EventRoute(id.id(), entity_component_mask_[id.index()]);
+  }
+
   inline void accomodate_entity(uint32_t index) {
     if (entity_component_mask_.size() <= index) {
       entity_component_mask_.resize(index + 1);
@@ -8,6 +8,8 @@
  * Author: Alec Thomas <alec@swapoff.org>
  */
 
+#include <algorithm>
+#include <ostream>
 #include "entityx/Event.h"
 
 namespace entityx {
@@ -21,8 +23,164 @@ EventManager::~EventManager() {
 }
 
 void EventManager::emit(const BaseEvent &event) {
-  auto sig = signal_for(event.my_family());
-  sig->emit(&event);
+  auto &channel = channel_for(event.my_family());
+#ifdef ENTITYX_INSTRUMENT_EVENTS
+  count_emit(channel, typeid(event));
+#endif
+  if (channel.queue) {
+    channel.queue->push(event);
+    return;
+  }
+  dispatch(channel, &event);
 }
 
+size_t EventManager::deliver_posted() {
+  if (!post_queue_) {
+    return 0;
+  }
+  // At most one queue's worth, so busy producers can't keep us here forever.
+  return post_queue_->consume([this](const BaseEvent &event) { emit(event); }, post_queue_->capacity());
+}
+
+void EventManager::deliver_routed(Channel &channel, const EventRoute &route, const BaseEvent &event) {
+  Routes &routes = *channel.routes;
+  auto deliver_to = [this, &routes, &event](const ptr<Channel> &target) {
+    if (target->queue && target->queue->size() == 0) {
+      routes.pending.push_back(target);
+    }
+    deliver(*target, event);
+  };
+
+  if (route.entity && !routes.by_entity.empty()) {
+    auto it = routes.by_entity.find(route.entity);
+    if (it != routes.by_entity.end()) {
+      deliver_to(it->second);
+    }
+  }
+
+  // Each component filter lives in the bucket of its lowest component, so we
+  // only look at buckets for components the entity has, and see each filter once.
+  ComponentMask candidates = route.components & routes.indexed;
+  for (size_t i = 0; candidates.any() && i < candidates.size(); ++i) {
+    if (candidates.test(i)) {
+      candidates.reset(i);
+      for (auto &filtered : routes.by_component[i]) {
+        if ((route.components & filtered.first) == filtered.first) {
+          deliver_to(filtered.second);
+        }
+      }
+    }
+  }
+}
+
+void EventManager::forget_entity(uint64_t id) {
+  if (entity_channels_.empty()) {
+    return;
+  }
+  auto it = entity_channels_.find(id);
+  if (it == entity_channels_.end()) {
+    return;
+  }
+  for (int family : it->second) {
+    // Queued events keep their channel alive through routes->pending.
+    handlers_[family].routes->by_entity.erase(id);
+  }
+  entity_channels_.erase(it);
+}
+
+void EventManager::drain(const Channel &channel) {
+  if (channel.queue && channel.queue->size()) {
+    ProfileZone zone(channel.drain_zone ? Profiler::current() : nullptr, channel.drain_zone);
+    channel.queue->deliver(*channel.signal, channel.batch_signal.get());
+  }
+  if (channel.routes && !channel.routes->pending.empty()) {
+    // Take the spare capacity, so a drain nested in a receiver gets its own.
+    auto &routes = *channel.routes;
+    std::vector<ptr<Channel>> pending;
+    pending.swap(routes.draining);
+    pending.swap(routes.pending);
+    for (auto &route : pending) {
+      drain(*route);
+    }
+    pending.clear();
+    if (pending.capacity() > routes.draining.capacity()) {
+      routes.draining.swap(pending);
+    }
+  }
+}
+
+void EventManager::drain() {
+  deliver_posted();
+  // Copy the queued channels first: receivers may emit new event types while
+  // we deliver, which would invalidate iterators into handlers_.
+  // The copies reuse the last drain's capacity; a nested drain gets its own.
+  // Each queue's events are likewise moved out before delivery (see
+  // EventQueue::deliver()), so a receiver may emit and drain again.
+  std::vector<Channel> queued;
+  queued.swap(draining_);
+  for (auto &pair : handlers_) {
+    if (pair.second.queue) {
+      queued.push_back(pair.second);
+    }
+  }
+  for (auto &channel : queued) {
+    drain(channel);
+  }
+  queued.clear();
+  if (queued.capacity() > draining_.capacity()) {
+    draining_.swap(queued);
+  }
+}
+
+#ifdef ENTITYX_INSTRUMENT_EVENTS
+
+void EventManager::end_frame() {
+  for (auto &pair : handlers_) {
+    auto &stats = pair.second.stats;
+    if (stats) {
+      stats->last_frame_emitted = stats->frame_emitted;
+      stats->frame_emitted = 0;
+      for (auto &receiver : stats->receivers) {
+        receiver->last_frame_seconds = receiver->frame_seconds;
+        receiver->frame_seconds = 0.0;
+      }
+    }
+  }
+}
+
+std::vector<ptr<const EventStats>> EventManager::stats() const {
+  std::vector<ptr<const EventStats>> all;
+  for (auto &pair : handlers_) {
+    auto &stats = pair.second.stats;
+    if (stats) {
+      stats->connected = pair.second.signal->size();
+      if (pair.second.batch_signal) {
+        stats->connected += pair.second.batch_signal->size();
+      }
+      all.push_back(stats);
+    }
+  }
+  std::sort(all.begin(), all.end(), [](const ptr<const EventStats> &a, const ptr<const EventStats> &b) {
+    return a->name < b->name;
+  });
+  return all;
+}
+
+void EventManager::write_stats_csv(std::ostream &out) const {
+  out << "event,emitted,last_frame_emitted,connected_receivers,receiver,calls,total_ms,last_frame_ms\n";
+  for (auto &stats : this->stats()) {
+    std::string prefix = "\"" + stats->name + "\"," + std::to_string(stats->emitted) + ","
+        + std::to_string(stats->last_frame_emitted) + "," + std::to_string(stats->connected) + ",";
+    if (stats->receivers.empty()) {
+      out << prefix << ",0,0,0\n";
+    }
+    for (auto &receiver : stats->receivers) {
+      out << prefix << "\"" << receiver->name << "\"," << receiver->calls << ","
+          << receiver->seconds * 1000.0 << "," << receiver->last_frame_seconds * 1000.0 << "\n";
+    }
+  }
+}
+
+#endif  // ENTITYX_INSTRUMENT_EVENTS
+
 }  // namespace entityx
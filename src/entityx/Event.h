@@ -15,14 +15,23 @@
 #include <boost/function.hpp>
 #include <boost/noncopyable.hpp>
 #include <boost/unordered_map.hpp>
+#include <algorithm>
+#include <cassert>
 #include <list>
 #include <utility>
+#include <vector>
 #include "entityx/config.h"
+#include "entityx/EventPostQueue.h"
+#include "entityx/EventStats.h"
+#include "entityx/Profiler.h"
+#include "entityx/TypeName.h"
 #include "entityx/3rdparty/simplesignal.h"
 
 
 namespace entityx {
 
+class Entity;
+
 
 /// Used internally by the EventManager.
 class BaseEvent {
@@ -42,6 +51,34 @@ typedef Simple::Signal<void (const BaseEvent*)> EventSignal;
 typedef ptr<EventSignal> EventSignalPtr;
 typedef weak_ptr<EventSignal> EventSignalWeakPtr;
 
+/// Delivers a contiguous run of events: pointer to the first event and the count.
+typedef Simple::Signal<void (const BaseEvent*, size_t)> EventBatchSignal;
+typedef ptr<EventBatchSignal> EventBatchSignalPtr;
+typedef weak_ptr<EventBatchSignal> EventBatchSignalWeakPtr;
+
+
+/**
+ * A non-owning view of a contiguous run of objects.
+ *
+ * Batch receivers are handed a span<const E> covering every event delivered
+ * in one go.
+ */
+template <typename T>
+class span {
+ public:
+  span(T *data, size_t size) : data_(data), size_(size) {}
+
+  T *begin() const { return data_; }
+  T *end() const { return data_ + size_; }
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  T &operator [] (size_t i) const { return data_[i]; }
+
+ private:
+  T *data_;
+  size_t size_;
+};
+
 
 /**
  * Event types should subclass from this.
@@ -73,6 +110,12 @@ class BaseReceiver {
         ptr.lock()->disconnect(connection.second);
       }
     }
+    for (auto connection : batch_connections_) {
+      auto &ptr = connection.first;
+      if (!ptr.expired()) {
+        ptr.lock()->disconnect(connection.second);
+      }
+    }
   }
 
   // Return number of signals connected to this receiver.
@@ -83,12 +126,74 @@ class BaseReceiver {
         size++;
       }
     }
+    for (auto connection : batch_connections_) {
+      if (!connection.first.expired()) {
+        size++;
+      }
+    }
     return size;
   }
 
  private:
   friend class EventManager;
   std::list<std::pair<EventSignalWeakPtr, size_t>> connections_;
+  std::list<std::pair<EventBatchSignalWeakPtr, size_t>> batch_connections_;
+};
+
+
+/// Used internally by the EventManager to buffer events of a queued type.
+class BaseEventQueue {
+ public:
+  virtual ~BaseEventQueue() {}
+
+  virtual void push(const BaseEvent &event) = 0;
+  virtual size_t size() const = 0;
+  /// Deliver every buffered event, then clear the buffer.
+  virtual void deliver(EventSignal &signal, EventBatchSignal *batch) = 0;
+};
+
+
+template <typename E>
+class EventQueue : public BaseEventQueue {
+ public:
+  void push(const BaseEvent &event) override {
+    events_.push_back(static_cast<const E &>(event));
+  }
+
+  template <typename ... Args>
+  void emplace(Args && ... args) {
+    events_.emplace_back(std::forward<Args>(args) ...);
+  }
+
+  size_t size() const override { return events_.size(); }
+
+  void deliver(EventSignal &signal, EventBatchSignal *batch) override {
+    if (events_.empty()) {
+      return;
+    }
+    // Receivers may emit more events of this type while we deliver; those
+    // land in events_ and wait for the next delivery. The batch is moved into
+    // a local, so a drain nested in a receiver delivers only the new events
+    // and never touches the vector we are iterating.
+    std::vector<E> delivering;
+    delivering.swap(delivering_);
+    delivering.swap(events_);
+    if (batch) {
+      batch->emit(static_cast<const BaseEvent*>(&delivering[0]), delivering.size());
+    }
+    for (const E &event : delivering) {
+      signal.emit(static_cast<const BaseEvent*>(&event));
+    }
+    // Keep the capacity for next time, unless a nested delivery already did.
+    delivering.clear();
+    if (delivering.capacity() > delivering_.capacity()) {
+      delivering_.swap(delivering);
+    }
+  }
+
+ private:
+  std::vector<E> events_;
+  std::vector<E> delivering_;
 };
 
 
@@ -99,10 +204,93 @@ class Receiver : public BaseReceiver {
 };
 
 
+/**
+ * Narrows a subscription to events about particular entities.
+ *
+ * Filters apply to events emitted with a route (see
+ * EventManager::emit_routed()). EntityManager routes EntityDestroyedEvent,
+ * ComponentAddedEvent and ComponentRemovedEvent.
+ *
+ *     // only destroyed entities that have a Body
+ *     em.subscribe<EntityDestroyedEvent>(receiver, EventFilter::components<Body>());
+ *     // only the player
+ *     em.subscribe<EntityDestroyedEvent>(receiver, EventFilter::entity(player));
+ */
+class EventFilter {
+ public:
+  /// Match events about the entity with this Entity::Id::id().
+  static EventFilter entity(uint64_t id) {
+    return EventFilter(id, ComponentMask());
+  }
+
+  /// Match events about this entity. Without this overload an Entity would
+  /// convert through operator bool and filter on id 1.
+  static EventFilter entity(const Entity &entity);
+
+  /// Match events about entities that have every component in mask.
+  static EventFilter components(const ComponentMask &mask) {
+    assert(mask.any() && "EventFilter needs at least one component");
+    return EventFilter(0, mask);
+  }
+
+  /// Match events about entities that have every one of the given components.
+  template <typename C, typename ... Components>
+  static EventFilter components() {
+    ComponentMask mask;
+    int families[] = { (mask.set(C::family()), 0), (mask.set(Components::family()), 0) ... };
+    (void)families;
+    return components(mask);
+  }
+
+  uint64_t entity_id() const { return entity_; }
+  const ComponentMask &mask() const { return mask_; }
+
+ private:
+  EventFilter(uint64_t entity, const ComponentMask &mask) : entity_(entity), mask_(mask) {}
+
+  uint64_t entity_;
+  ComponentMask mask_;
+};
+
+
+/**
+ * What an event is about: the entity's id and the components it has.
+ *
+ * Passed to EventManager::emit_routed() so filtered subscriptions can be
+ * matched without looking anything up.
+ */
+struct EventRoute {
+  EventRoute(uint64_t entity, const ComponentMask &components) : entity(entity), components(components) {}
+
+  uint64_t entity;
+  ComponentMask components;
+};
+
+
 /**
  * Handles event subscription and delivery.
  *
  * Subscriptions are automatically removed when receivers are destroyed..
+ *
+ * By default events are delivered synchronously inside emit(). Calling
+ * queue<E>() turns E into a queued channel: emitted events are appended to a
+ * contiguous buffer and only delivered when drain() is called. Batch receivers
+ * (see subscribe_batch()) then see the whole run at once.
+ *
+ * The EventManager is not thread safe. Other threads hand events to it with
+ * post(), which is; posted events are delivered on the owning thread by
+ * deliver_posted() or drain().
+ *
+ * When built with ENTITYX_INSTRUMENT_EVENTS, the EventManager also counts
+ * emitted events and times every receiver; see stats().
+ *
+ * With a Profiler::current(), delivery of each event family is recorded as
+ * the zones "EventManager::dispatch<E>" (synchronous delivery) and
+ * "EventManager::drain<E>" (queued delivery).
+ *
+ * Subscriptions can be narrowed with an EventFilter. Filtered receivers are
+ * kept in an index by entity id and by component, so routed events only reach
+ * the receivers that asked for them.
  */
 class EventManager : boost::noncopyable {
  public:
@@ -130,14 +318,122 @@ class EventManager : boost::noncopyable {
    */
   template <typename E, typename Receiver>
   void subscribe(Receiver &receiver) {  //NOLINT
-    void (Receiver::*receive)(const E &) = &Receiver::receive;
-    auto sig = signal_for(E::family());
-    auto wrapper = EventCallbackWrapper<E>(boost::bind(receive, &receiver, _1));
-    auto connection = sig->connect(wrapper);
-    static_cast<BaseReceiver&>(receiver).connections_.push_back(
-      std::make_pair(EventSignalWeakPtr(sig), connection));
+    connect<E>(channel_for(E::family()), receiver);
+  }
+
+  /**
+   * Subscribe an object to receive only the routed events of type E that
+   * match filter.
+   */
+  template <typename E, typename Receiver>
+  void subscribe(Receiver &receiver, const EventFilter &filter) {  //NOLINT
+    connect<E>(route_for<E>(channel_for(E::family()), filter), receiver);
+  }
+
+  /**
+   * Subscribe an object to receive events of type E in batches.
+   *
+   * The receiver must implement receive(span<const E>). Events from a queued
+   * channel arrive together when the channel is drained; events from an
+   * unqueued channel arrive one at a time, as a span of size one.
+   *
+   *     struct DebrisReceiver : public Receiver<DebrisReceiver> {
+   *       void receive(span<const Explosion> explosions) {
+   *       }
+   *     };
+   *
+   *     em.queue<Explosion>();
+   *     em.subscribe_batch<Explosion>(receiver);
+   */
+  template <typename E, typename Receiver>
+  void subscribe_batch(Receiver &receiver) {  //NOLINT
+    connect_batch<E>(channel_for(E::family()), receiver);
+  }
+
+  /**
+   * Subscribe an object to receive batches of the routed events of type E
+   * that match filter.
+   */
+  template <typename E, typename Receiver>
+  void subscribe_batch(Receiver &receiver, const EventFilter &filter) {  //NOLINT
+    connect_batch<E>(route_for<E>(channel_for(E::family()), filter), receiver);
+  }
+
+  /**
+   * Turn E into a queued channel.
+   *
+   * Events of type E emitted after this call are buffered until drain<E>() or
+   * drain() is called. Receivers therefore see them after the fact; for
+   * instance, entities carried by a queued EntityDestroyedEvent are no longer
+   * valid by the time it is delivered.
+   */
+  template <typename E>
+  void queue() {
+    auto &channel = channel_for(E::family());
+    if (!channel.queue) {
+      channel.queue.reset(new EventQueue<E>());
+      name_zones<E>(channel);
+    }
+    if (channel.routes) {
+      channel.routes->for_each([](Channel &route) {
+        if (!route.queue) {
+          route.queue.reset(new EventQueue<E>());
+        }
+      });
+    }
+  }
+
+  /**
+   * Deliver all buffered events of type E.
+   */
+  template <typename E>
+  void drain() {
+    drain(channel_for(E::family()));
+  }
+
+  /**
+   * Deliver posted events, then all buffered events of every queued type.
+   */
+  void drain();
+
+  /**
+   * Allow other threads to post() events.
+   *
+   * Call once from the owning thread, before any other thread posts.
+   *
+   * @param capacity Maximum number of undelivered posted events.
+   */
+  void enable_posting(size_t capacity = 4096) {
+    if (!post_queue_) {
+      post_queue_.reset(new EventPostQueue(capacity));
+    }
+  }
+
+  /**
+   * Post an event from any thread.
+   *
+   * The event is constructed in place in a lock-free queue and delivered to
+   * the normal receivers the next time the owning thread calls
+   * deliver_posted() or drain(). Posting never blocks or allocates.
+   *
+   *     // on the audio thread
+   *     events->post<BeatEvent>(bar, beat);
+   *
+   * @returns false if the queue was full and the event was dropped.
+   */
+  template <typename E, typename ... Args>
+  bool post(Args && ... args) {
+    assert(post_queue_ && "EventManager::enable_posting() not called");
+    return post_queue_->push<E>(std::forward<Args>(args) ...);
   }
 
+  /**
+   * Emit every event posted so far. Call from the owning thread.
+   *
+   * @returns Number of events delivered.
+   */
+  size_t deliver_posted();
+
   void emit(const BaseEvent &event);
 
   /**
@@ -145,8 +441,7 @@ class EventManager : boost::noncopyable {
    */
   template <typename E>
   void emit(ptr<E> event) {
-    auto sig = signal_for(E::family());
-    sig->emit(static_cast<BaseEvent*>(event.get()));
+    emit(static_cast<const BaseEvent &>(*event));
   }
 
   /**
@@ -162,39 +457,322 @@ class EventManager : boost::noncopyable {
    */
   template <typename E, typename ... Args>
   void emit(Args && ... args) {
-    E event(args ...);
-    auto sig = signal_for(E::family());
-    sig->emit(static_cast<BaseEvent*>(&event));
+    auto &channel = channel_for(E::family());
+#ifdef ENTITYX_INSTRUMENT_EVENTS
+    count_emit(channel, typeid(E));
+#endif
+    if (channel.queue) {
+      static_cast<EventQueue<E>&>(*channel.queue).emplace(std::forward<Args>(args) ...);
+      return;
+    }
+    E event(std::forward<Args>(args) ...);
+    dispatch(channel, static_cast<const BaseEvent*>(&event));
+  }
+
+  /**
+   * Emit an event about an entity.
+   *
+   * Unfiltered receivers get the event as with emit(); filtered receivers get
+   * it only if their EventFilter matches route.
+   */
+  template <typename E, typename ... Args>
+  void emit_routed(const EventRoute &route, Args && ... args) {
+    auto &channel = channel_for(E::family());
+    if (!channel.routes) {
+      emit<E>(std::forward<Args>(args) ...);
+      return;
+    }
+#ifdef ENTITYX_INSTRUMENT_EVENTS
+    count_emit(channel, typeid(E));
+#endif
+    E event(std::forward<Args>(args) ...);
+    deliver(channel, event);
+    deliver_routed(channel, route, event);
   }
 
+  /**
+   * Drop subscriptions filtered on an entity that no longer exists.
+   *
+   * Called by EntityManager::destroy(). Events already queued for those
+   * subscriptions are still delivered by the next drain().
+   */
+  void forget_entity(uint64_t id);
+
   int connected_receivers() const {
     int size = 0;
-    for (auto pair : handlers_) {
-      size += pair.second->size();
+    for (auto &pair : handlers_) {
+      size += connected_receivers(pair.second);
+      if (pair.second.routes) {
+        pair.second.routes->for_each([&size](const Channel &route) {
+          size += connected_receivers(route);
+        });
+      }
     }
     return size;
   }
 
+  /**
+   * Mark the end of a frame for per-frame statistics.
+   *
+   * Does nothing unless ENTITYX_INSTRUMENT_EVENTS is defined.
+   */
+#ifdef ENTITYX_INSTRUMENT_EVENTS
+  void end_frame();
+#else
+  void end_frame() {}
+#endif
+
+#ifdef ENTITYX_INSTRUMENT_EVENTS
+  /**
+   * Statistics for every event family seen so far, ordered by name.
+   */
+  std::vector<ptr<const EventStats>> stats() const;
+
+  /**
+   * Write stats() as CSV, one row per event and receiver.
+   */
+  void write_stats_csv(std::ostream &out) const;
+#endif
+
+  /**
+   * Number of events of type E waiting to be drained.
+   */
+  template <typename E>
+  size_t queued() const {
+    auto it = handlers_.find(E::family());
+    return (it == handlers_.end() || !it->second.queue) ? 0 : it->second.queue->size();
+  }
+
  private:
-  EventSignalPtr signal_for(int id) {
+  struct Routes;
+
+  // Everything the EventManager knows about one event family, or about one
+  // filter of a family.
+  struct Channel {
+    EventSignalPtr signal;
+    EventBatchSignalPtr batch_signal;
+    ptr<BaseEventQueue> queue;
+    // Filtered subscriptions; only set on a family's main channel.
+    ptr<Routes> routes;
+    // Profiler zones for delivering the family; set once it has receivers.
+    const char *dispatch_zone = nullptr;
+    const char *drain_zone = nullptr;
+#ifdef ENTITYX_INSTRUMENT_EVENTS
+    ptr<EventStats> stats;
+#endif
+  };
+
+  // Index of the filtered channels of one event family.
+  struct Routes {
+    Routes() : by_component(MAX_COMPONENTS) {}
+
+    template <typename Fn>
+    void for_each(Fn fn) const {
+      for (auto &pair : by_entity) {
+        fn(*pair.second);
+      }
+      for (auto &bucket : by_component) {
+        for (auto &route : bucket) {
+          fn(*route.second);
+        }
+      }
+    }
+
+    boost::unordered_map<uint64_t, ptr<Channel>> by_entity;
+    // Component filters, bucketed by the lowest component in their mask.
+    std::vector<std::vector<std::pair<ComponentMask, ptr<Channel>>>> by_component;
+    // Components that have a non-empty bucket.
+    ComponentMask indexed;
+    // Filtered channels holding queued events.
+    std::vector<ptr<Channel>> pending;
+    // Capacity kept between drains to swap pending into.
+    std::vector<ptr<Channel>> draining;
+  };
+
+  static int connected_receivers(const Channel &channel) {
+    int size = channel.signal->size();
+    if (channel.batch_signal) {
+      size += channel.batch_signal->size();
+    }
+    return size;
+  }
+
+  template <typename E, typename Receiver>
+  void connect(Channel &channel, Receiver &receiver) {
+    void (Receiver::*receive)(const E &) = &Receiver::receive;
+    auto wrapper = EventCallbackWrapper<E>(boost::bind(receive, &receiver, _1));
+#ifdef ENTITYX_INSTRUMENT_EVENTS
+    wrapper.stats = receiver_stats_for(E::family(), typeid(E), typeid(Receiver));
+#endif
+    name_zones<E>(channel);
+    auto connection = channel.signal->connect(wrapper);
+    static_cast<BaseReceiver&>(receiver).connections_.push_back(
+      std::make_pair(EventSignalWeakPtr(channel.signal), connection));
+  }
+
+  template <typename E, typename Receiver>
+  void connect_batch(Channel &channel, Receiver &receiver) {
+    void (Receiver::*receive)(span<const E>) = &Receiver::receive;
+    if (!channel.batch_signal) {
+      channel.batch_signal.reset(new EventBatchSignal());
+    }
+    auto wrapper = EventBatchCallbackWrapper<E>(boost::bind(receive, &receiver, _1));
+#ifdef ENTITYX_INSTRUMENT_EVENTS
+    wrapper.stats = receiver_stats_for(E::family(), typeid(E), typeid(Receiver));
+    wrapper.stats->name += " (batch)";
+#endif
+    name_zones<E>(channel);
+    auto connection = channel.batch_signal->connect(wrapper);
+    static_cast<BaseReceiver&>(receiver).batch_connections_.push_back(
+      std::make_pair(EventBatchSignalWeakPtr(channel.batch_signal), connection));
+  }
+
+  // Names live as long as the program, so outlive any Profiler.
+  template <typename E>
+  static void name_zones(Channel &channel) {
+    static const std::string dispatch = "EventManager::dispatch<" + type_name(typeid(E)) + ">";
+    static const std::string drain = "EventManager::drain<" + type_name(typeid(E)) + ">";
+    channel.dispatch_zone = dispatch.c_str();
+    channel.drain_zone = drain.c_str();
+  }
+
+  // Find or create the filtered channel for filter.
+  template <typename E>
+  Channel &route_for(Channel &channel, const EventFilter &filter) {
+    if (!channel.routes) {
+      channel.routes.reset(new Routes());
+    }
+    ptr<Channel> *route;
+    if (filter.entity_id()) {
+      route = &channel.routes->by_entity[filter.entity_id()];
+    } else {
+      size_t lowest = 0;
+      while (!filter.mask().test(lowest)) {
+        ++lowest;
+      }
+      auto &bucket = channel.routes->by_component[lowest];
+      auto it = std::find_if(bucket.begin(), bucket.end(), [&filter](const std::pair<ComponentMask, ptr<Channel>> &r) {
+        return r.first == filter.mask();
+      });
+      if (it == bucket.end()) {
+        it = bucket.insert(bucket.end(), std::make_pair(filter.mask(), ptr<Channel>()));
+      }
+      channel.routes->indexed.set(lowest);
+      route = &it->second;
+    }
+    if (!*route) {
+      route->reset(new Channel());
+      (*route)->signal.reset(new EventSignal());
+      if (channel.queue) {
+        (*route)->queue.reset(new EventQueue<E>());
+      }
+      if (filter.entity_id()) {
+        entity_channels_[filter.entity_id()].push_back(E::family());
+      }
+    }
+    return **route;
+  }
+
+  Channel &channel_for(int id) {
     auto it = handlers_.find(id);
     if (it == handlers_.end()) {
-      EventSignalPtr sig(new EventSignal());
-      handlers_.insert(std::make_pair(id, sig));
-      return sig;
+      Channel channel;
+      channel.signal.reset(new EventSignal());
+      it = handlers_.insert(std::make_pair(id, channel)).first;
     }
     return it->second;
   }
 
+  EventSignalPtr signal_for(int id) {
+    return channel_for(id).signal;
+  }
+
+#ifdef ENTITYX_INSTRUMENT_EVENTS
+  EventStats &stats_for(Channel &channel, const std::type_info &event) {
+    if (!channel.stats) {
+      channel.stats.reset(new EventStats(type_name(event)));
+    }
+    return *channel.stats;
+  }
+
+  void count_emit(Channel &channel, const std::type_info &event) {
+    auto &stats = stats_for(channel, event);
+    stats.emitted += 1;
+    stats.frame_emitted += 1;
+  }
+
+  ptr<EventStats::Receiver> receiver_stats_for(int id, const std::type_info &event, const std::type_info &receiver) {
+    ptr<EventStats::Receiver> stats(new EventStats::Receiver(type_name(receiver)));
+    stats_for(channel_for(id), event).receivers.push_back(stats);
+    return stats;
+  }
+#endif
+
+  void dispatch(Channel &channel, const BaseEvent *event) {
+    ProfileZone zone(channel.dispatch_zone ? Profiler::current() : nullptr, channel.dispatch_zone);
+    channel.signal->emit(event);
+    if (channel.batch_signal) {
+      channel.batch_signal->emit(event, 1);
+    }
+  }
+
+  // Queue or dispatch event on one channel.
+  void deliver(Channel &channel, const BaseEvent &event) {
+    if (channel.queue) {
+      channel.queue->push(event);
+    } else {
+      dispatch(channel, &event);
+    }
+  }
+
+  void deliver_routed(Channel &channel, const EventRoute &route, const BaseEvent &event);
+
+  void drain(const Channel &channel);
+
   // Functor used as an event signal callback that casts to E.
   template <typename E>
   struct EventCallbackWrapper {
     EventCallbackWrapper(boost::function<void(const E &)> callback) : callback(callback) {}
-    void operator()(const BaseEvent* event) { callback(*(static_cast<const E*>(event))); }
+    void operator()(const BaseEvent* event) {
+#ifdef ENTITYX_INSTRUMENT_EVENTS
+      ReceiverTimer timer(stats.get());
+#endif
+      callback(*(static_cast<const E*>(event)));
+    }
     boost::function<void(const E &)> callback;
+#ifdef ENTITYX_INSTRUMENT_EVENTS
+    ptr<EventStats::Receiver> stats;
+#endif
   };
 
-  boost::unordered_map<int, EventSignalPtr> handlers_;
+  // Functor used as a batch signal callback that casts to a span of E.
+  template <typename E>
+  struct EventBatchCallbackWrapper {
+    EventBatchCallbackWrapper(boost::function<void(span<const E>)> callback) : callback(callback) {}
+    void operator()(const BaseEvent* event, size_t count) {
+#ifdef ENTITYX_INSTRUMENT_EVENTS
+      ReceiverTimer timer(stats.get());
+#endif
+      callback(span<const E>(static_cast<const E*>(event), count));
+    }
+    boost::function<void(span<const E>)> callback;
+#ifdef ENTITYX_INSTRUMENT_EVENTS
+    ptr<EventStats::Receiver> stats;
+#endif
+  };
+
+  boost::unordered_map<int, Channel> handlers_;
+  // Channels with subscriptions filtered on each entity, so destroying one
+  // only visits those.
+  boost::unordered_map<uint64_t, std::vector<int>> entity_channels_;
+  ptr<EventPostQueue> post_queue_;
+  // Capacity kept between drains for the queued channels.
+  std::vector<Channel> draining_;
 };
 
+
+inline void EventPostQueue::destroy(BaseEvent *event) {
+  event->~BaseEvent();
+}
+
 }  // namespace entityx
@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2012 Alec Thomas <alec@swapoff.org>
+ * All rights reserved.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution.
+ *
+ * Author: Alec Thomas <alec@swapoff.org>
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <cassert>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <boost/noncopyable.hpp>
+#include "entityx/config.h"
+
+namespace entityx {
+
+class BaseEvent;
+
+/**
+ * Bounded lock-free queue of events, written by any number of threads and
+ * read by one.
+ *
+ * Events are constructed in place in fixed-size slots, so posting never
+ * allocates. This is the cell-sequence ring described by Dmitry Vyukov,
+ * restricted to a single consumer.
+ *
+ * Used by EventManager::post(); there is usually no need to use it directly.
+ */
+class EventPostQueue : boost::noncopyable {
+ public:
+  /// Largest event that fits in a slot. Larger payloads should be posted by pointer.
+  static const size_t SLOT_SIZE = 64;
+
+  /// @param capacity Rounded up to a power of two.
+  explicit EventPostQueue(size_t capacity) : cells_(round_up(capacity)), mask_(cells_.size() - 1) {
+    for (size_t i = 0; i < cells_.size(); ++i) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    enqueue_pos_.store(0, std::memory_order_relaxed);
+  }
+
+  ~EventPostQueue() {
+    // Destroy anything that was posted but never delivered.
+    consume([](const BaseEvent &) {}, cells_.size());
+  }
+
+  /**
+   * Construct an E in the next free slot. Safe to call from any thread.
+   *
+   * @returns false if the queue is full; the event is dropped.
+   */
+  template <typename E, typename ... Args>
+  bool push(Args && ... args) {
+    static_assert(sizeof(E) <= SLOT_SIZE, "Event is too large to post; post a pointer to its payload instead");
+    static_assert(std::alignment_of<E>::value <= std::alignment_of<Storage>::value, "Event alignment too strict to post");
+    Cell *cell;
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    for (;;) {
+      cell = &cells_[pos & mask_];
+      size_t seq = cell->sequence.load(std::memory_order_acquire);
+      intptr_t dif = intptr_t(seq) - intptr_t(pos);
+      if (dif == 0) {
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (dif < 0) {
+        return false;
+      } else {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    cell->event = new (&cell->storage) E(std::forward<Args>(args) ...);
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * Hand up to `limit` events to fn, oldest first, destroying each afterwards.
+   * Must only be called from the consuming thread.
+   *
+   * @returns Number of events consumed.
+   */
+  template <typename Fn>
+  size_t consume(Fn fn, size_t limit) {
+    size_t count = 0;
+    while (count < limit) {
+      Cell &cell = cells_[dequeue_pos_ & mask_];
+      if (cell.sequence.load(std::memory_order_acquire) != dequeue_pos_ + 1) {
+        break;  // empty, or the producer that claimed this slot hasn't finished writing it
+      }
+      fn(*cell.event);
+      destroy(cell.event);
+      cell.sequence.store(dequeue_pos_ + mask_ + 1, std::memory_order_release);
+      ++dequeue_pos_;
+      ++count;
+    }
+    return count;
+  }
+
+  size_t capacity() const { return cells_.size(); }
+
+ private:
+  typedef std::aligned_storage<SLOT_SIZE, sizeof(void*) * 2>::type Storage;
+
+  struct Cell {
+    std::atomic<size_t> sequence;
+    BaseEvent *event;
+    Storage storage;
+  };
+
+  static size_t round_up(size_t n) {
+    size_t size = 2;
+    while (size < n) {
+      size <<= 1;
+    }
+    return size;
+  }
+
+  // Defined in Event.h, where BaseEvent is complete.
+  static void destroy(BaseEvent *event);
+
+  std::vector<Cell> cells_;
+  const size_t mask_;
+  // Producers and the consumer work on different cache lines.
+  char pad0_[64];
+  std::atomic<size_t> enqueue_pos_;
+  char pad1_[64];
+  size_t dequeue_pos_ = 0;
+};
+
+}  // namespace entityx
@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2012 Alec Thomas <alec@swapoff.org>
+ * All rights reserved.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution.
+ *
+ * Author: Alec Thomas <alec@swapoff.org>
+ */
+
+#pragma once
+
+#include "entityx/config.h"
+
+#ifdef ENTITYX_INSTRUMENT_EVENTS
+
+#include <stdint.h>
+#include <chrono>
+#include <iosfwd>
+#include <string>
+#include <vector>
+#include "entityx/TypeName.h"
+
+namespace entityx {
+
+/**
+ * Statistics the EventManager gathers for one event family.
+ *
+ * Only available when ENTITYX_INSTRUMENT_EVENTS is defined.
+ */
+struct EventStats {
+  struct Receiver {
+    explicit Receiver(const std::string &name) : name(name) {}
+
+    std::string name;
+    uint64_t calls = 0;
+    // Cumulative time spent in this receiver.
+    double seconds = 0.0;
+    double frame_seconds = 0.0;
+    double last_frame_seconds = 0.0;
+  };
+
+  explicit EventStats(const std::string &name) : name(name) {}
+
+  std::string name;
+  uint64_t emitted = 0;
+  uint64_t frame_emitted = 0;
+  uint64_t last_frame_emitted = 0;
+  // Receivers currently connected.
+  int connected = 0;
+  // Every receiver ever subscribed, including ones since destroyed.
+  std::vector<ptr<Receiver>> receivers;
+};
+
+
+/// Adds the lifetime of this object to a receiver's timings.
+class ReceiverTimer {
+ public:
+  explicit ReceiverTimer(EventStats::Receiver *stats) : stats_(stats) {
+    if (stats_) {
+      start_ = std::chrono::high_resolution_clock::now();
+    }
+  }
+
+  ~ReceiverTimer() {
+    if (stats_) {
+      double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start_).count();
+      stats_->calls += 1;
+      stats_->seconds += seconds;
+      stats_->frame_seconds += seconds;
+    }
+  }
+
+ private:
+  EventStats::Receiver *stats_;
+  std::chrono::high_resolution_clock::time_point start_;
+};
+
+}  // namespace entityx
+
+#endif  // ENTITYX_INSTRUMENT_EVENTS
@@ -0,0 +1,214 @@
+/*
+ * Copyright (C) 2012 Alec Thomas <alec@swapoff.org>
+ * All rights reserved.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution.
+ *
+ * Author: Alec Thomas <alec@swapoff.org>
+ */
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <iomanip>
+#include <ostream>
+#include "entityx/Profiler.h"
+
+namespace entityx {
+
+std::atomic<uint32_t> Profiler::thread_counter_(0);
+
+static size_t round_up(size_t n) {
+  size_t size = 2;
+  while (size < n) {
+    size <<= 1;
+  }
+  return size;
+}
+
+Profiler::Profiler(size_t capacity)
+    : samples_(round_up(capacity)), mask_(samples_.size() - 1), head_(0), epoch_(Clock::now()),
+      histograms_(new Histogram[MAX_ZONES]) {
+  for (size_t i = 0; i < MAX_ZONES; ++i) {
+    histograms_[i].name = nullptr;
+  }
+  clear();
+}
+
+void Profiler::clear() {
+  head_ = 0;
+  for (size_t i = 0; i < MAX_ZONES; ++i) {
+    Histogram &histogram = histograms_[i];
+    histogram.total = 0;
+    histogram.max = 0;
+    for (auto &bucket : histogram.buckets) {
+      bucket = 0;
+    }
+  }
+}
+
+size_t Profiler::bucket_for(uint64_t ns) {
+  const uint64_t sub_buckets = 1 << SUB_BUCKET_BITS;
+  if (ns < sub_buckets) {
+    return ns;
+  }
+  int msb = SUB_BUCKET_BITS;
+  while (ns >> (msb + 1)) {
+    ++msb;
+  }
+  size_t bucket = (size_t(msb - SUB_BUCKET_BITS + 1) << SUB_BUCKET_BITS)
+      | ((ns >> (msb - SUB_BUCKET_BITS)) & (sub_buckets - 1));
+  return std::min(bucket, HISTOGRAM_BUCKETS - 1);
+}
+
+uint64_t Profiler::bucket_middle(size_t bucket) {
+  const uint64_t sub_buckets = 1 << SUB_BUCKET_BITS;
+  if (bucket < sub_buckets) {
+    return bucket;
+  }
+  int shift = int(bucket >> SUB_BUCKET_BITS) - 1;
+  uint64_t lowest = (sub_buckets + (bucket & (sub_buckets - 1))) << shift;
+  return lowest + ((uint64_t(1) << shift) >> 1);
+}
+
+void Profiler::count(const char *name, uint64_t ns) {
+  size_t hash = reinterpret_cast<uintptr_t>(name);
+  hash ^= hash >> 7;
+  for (size_t i = 0; i < MAX_ZONES; ++i) {
+    Histogram &histogram = histograms_[(hash + i) & (MAX_ZONES - 1)];
+    const char *claimed = histogram.name.load(std::memory_order_acquire);
+    if (!claimed && histogram.name.compare_exchange_strong(claimed, name)) {
+      claimed = name;
+    }
+    if (claimed != name) {
+      continue;
+    }
+    histogram.total.fetch_add(ns, std::memory_order_relaxed);
+    histogram.buckets[bucket_for(ns)].fetch_add(1, std::memory_order_relaxed);
+    uint64_t max = histogram.max.load(std::memory_order_relaxed);
+    while (ns > max && !histogram.max.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {
+    }
+    return;
+  }
+}
+
+const char *Profiler::intern(const std::string &name) {
+  std::lock_guard<std::mutex> lock(names_mutex_);
+  return names_.insert(name).first->c_str();
+}
+
+std::vector<Profiler::Sample> Profiler::samples() const {
+  uint64_t head = head_.load();
+  uint64_t count = std::min<uint64_t>(head, samples_.size());
+  std::vector<Sample> samples;
+  samples.reserve(count);
+  for (uint64_t i = head - count; i < head; ++i) {
+    samples.push_back(samples_[i & mask_]);
+  }
+  return samples;
+}
+
+std::vector<Profiler::Zone> Profiler::zones() const {
+  std::vector<Zone> zones;
+  this->zones(zones);
+  return zones;
+}
+
+void Profiler::zones(std::vector<Zone> &zones) const {
+  zones.clear();
+  // Histograms in use, sorted by name so equal names are adjacent.
+  std::array<const Histogram *, MAX_ZONES> used;
+  size_t count = 0;
+  for (size_t i = 0; i < MAX_ZONES; ++i) {
+    if (histograms_[i].name.load()) {
+      used[count++] = &histograms_[i];
+    }
+  }
+  std::sort(used.begin(), used.begin() + count, [](const Histogram *a, const Histogram *b) {
+    return std::strcmp(a->name.load(), b->name.load()) < 0;
+  });
+  std::array<uint64_t, HISTOGRAM_BUCKETS> buckets;
+  for (size_t first = 0, last; first < count; first = last) {
+    Zone zone;
+    zone.name = used[first]->name.load();
+    zone.count = 0;
+    uint64_t total = 0;
+    uint64_t max = 0;
+    buckets.fill(0);
+    for (last = first; last < count && std::strcmp(used[last]->name.load(), zone.name) == 0; ++last) {
+      const Histogram &histogram = *used[last];
+      total += histogram.total.load();
+      max = std::max(max, histogram.max.load());
+      for (size_t b = 0; b < HISTOGRAM_BUCKETS; ++b) {
+        uint64_t n = histogram.buckets[b].load();
+        buckets[b] += n;
+        zone.count += n;
+      }
+    }
+    if (zone.count == 0) {
+      continue;
+    }
+    // The bucket holding the sample of this rank, counting from zero.
+    auto percentile = [&](uint64_t rank) {
+      uint64_t seen = 0;
+      for (size_t b = 0; b < HISTOGRAM_BUCKETS; ++b) {
+        seen += buckets[b];
+        if (seen > rank) {
+          return std::min(bucket_middle(b), max) / 1.0e6;
+        }
+      }
+      return max / 1.0e6;
+    };
+    zone.total = total / 1.0e6;
+    zone.p50 = percentile((zone.count - 1) / 2);
+    zone.p99 = percentile((zone.count - 1) * 99 / 100);
+    zone.max = max / 1.0e6;
+    zones.push_back(zone);
+  }
+}
+
+void Profiler::write_zones_csv(std::ostream &out) const {
+  out << "zone,count,total_ms,p50_ms,p99_ms,max_ms\n";
+  for (auto &zone : zones()) {
+    out << '"' << zone.name << "\"," << zone.count << ',' << zone.total << ','
+        << zone.p50 << ',' << zone.p99 << ',' << zone.max << '\n';
+  }
+}
+
+static void write_json_string(std::ostream &out, const char *s) {
+  out << '"';
+  for (; *s; ++s) {
+    if (*s == '"' || *s == '\\') {
+      out << '\\';
+    }
+    out << *s;
+  }
+  out << '"';
+}
+
+void Profiler::write_chrome_trace(std::ostream &out) const {
+  auto samples = this->samples();
+  std::stable_sort(samples.begin(), samples.end(), [](const Sample &a, const Sample &b) {
+    return a.start < b.start;
+  });
+  // Timestamps are in microseconds; keep nanosecond resolution.
+  std::ios::fmtflags flags = out.flags();
+  std::streamsize precision = out.precision();
+  out << std::fixed << std::setprecision(3);
+  out << "{\"traceEvents\":[";
+  const char *separator = "\n";
+  for (auto &sample : samples) {
+    out << separator << "{\"name\":";
+    write_json_string(out, sample.name);
+    out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << sample.thread
+        << ",\"ts\":" << sample.start / 1000.0
+        << ",\"dur\":" << (sample.end - sample.start) / 1000.0 << "}";
+    separator = ",\n";
+  }
+  out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+  out.flags(flags);
+  out.precision(precision);
+}
+
+}  // namespace entityx
@@ -0,0 +1,194 @@
+/*
+ * Copyright (C) 2012 Alec Thomas <alec@swapoff.org>
+ * All rights reserved.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution.
+ *
+ * Author: Alec Thomas <alec@swapoff.org>
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+#include <boost/noncopyable.hpp>
+#include "entityx/config.h"
+
+namespace entityx {
+
+/**
+ * Records how long named zones of code take.
+ *
+ * Samples go into a fixed-size ring that any thread can write to without
+ * locking; once it is full the oldest samples are overwritten. Each sample is
+ * also counted into a fixed-bucket histogram of its zone, which covers the
+ * whole run. Read the histograms with zones() or write_zones_csv(), and the
+ * ring with samples() or write_chrome_trace() (open the file in
+ * chrome://tracing), while no zones are being recorded, eg. between frames.
+ *
+ * Give a SystemManager a Profiler to time every System. Time your own code
+ * with a ProfileZone:
+ *
+ *     void update(ptr<EntityManager> es, ptr<EventManager> events, double dt) {
+ *       ProfileZone zone("broadphase");
+ *       ...
+ *     }
+ */
+class Profiler : boost::noncopyable {
+ public:
+  typedef std::chrono::steady_clock Clock;
+
+  struct Sample {
+    const char *name;
+    uint32_t thread;
+    // Nanoseconds since the Profiler was created.
+    uint64_t start;
+    uint64_t end;
+  };
+
+  /**
+   * Durations of every sample of one zone since the Profiler was created or
+   * cleared, in milliseconds. Percentiles are accurate to within 1/16.
+   */
+  struct Zone {
+    const char *name;
+    size_t count;
+    double total;
+    double p50;
+    double p99;
+    double max;
+  };
+
+  /// Zones with histograms; samples of any more are only kept in the ring.
+  static const size_t MAX_ZONES = 128;
+
+  /// @param capacity Number of samples kept, rounded up to a power of two.
+  static ptr<Profiler> make(size_t capacity = 65536) {
+    return ptr<Profiler>(new Profiler(capacity));
+  }
+
+  explicit Profiler(size_t capacity);
+
+  /// Nanoseconds since the Profiler was created.
+  uint64_t now() const {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - epoch_).count();
+  }
+
+  /**
+   * Record one sample. Safe to call from any thread.
+   *
+   * @param name Must outlive the Profiler; usually a string literal, or intern()ed.
+   */
+  void record(const char *name, uint64_t start, uint64_t end) {
+    Sample &sample = samples_[head_.fetch_add(1, std::memory_order_relaxed) & mask_];
+    sample.name = name;
+    sample.thread = thread_index();
+    sample.start = start;
+    sample.end = end;
+    count(name, end - start);
+  }
+
+  /**
+   * A copy of name that lives as long as the Profiler, for recording under
+   * names that might not. Equal names share one copy. Safe to call from any
+   * thread, but takes a lock, so intern names once rather than per sample.
+   */
+  const char *intern(const std::string &name);
+
+  /// Recorded samples, oldest first.
+  std::vector<Sample> samples() const;
+
+  /// Per-zone statistics, sorted by name.
+  std::vector<Zone> zones() const;
+
+  /// Per-zone statistics, sorted by name, into zones, reusing its capacity.
+  void zones(std::vector<Zone> &zones) const;
+
+  void write_zones_csv(std::ostream &out) const;
+
+  /// Write the recorded samples in Chrome's trace event format.
+  void write_chrome_trace(std::ostream &out) const;
+
+  /// Forget every sample and histogram.
+  void clear();
+
+  /// The Profiler ProfileZones on this thread record into by default; set by SystemManager.
+  static Profiler *&current() {
+    static thread_local Profiler *profiler = nullptr;
+    return profiler;
+  }
+
+  /// Small, stable number for the calling thread.
+  static uint32_t thread_index() {
+    static thread_local uint32_t index = thread_counter_++;
+    return index;
+  }
+
+ private:
+  // Durations below 8ns get a bucket each; every power of two above that is
+  // split into 8 buckets, up to about 18 minutes.
+  static const int SUB_BUCKET_BITS = 3;
+  static const size_t HISTOGRAM_BUCKETS = 39 << SUB_BUCKET_BITS;
+
+  struct Histogram {
+    // The zone's name pointer; equal names at different addresses are
+    // merged when read.
+    std::atomic<const char *> name;
+    std::atomic<uint64_t> total;
+    std::atomic<uint64_t> max;
+    std::atomic<uint64_t> buckets[HISTOGRAM_BUCKETS];
+  };
+
+  static size_t bucket_for(uint64_t ns);
+  static uint64_t bucket_middle(size_t bucket);
+
+  // Add one duration to name's histogram.
+  void count(const char *name, uint64_t ns);
+
+  static std::atomic<uint32_t> thread_counter_;
+
+  std::vector<Sample> samples_;
+  const size_t mask_;
+  std::atomic<uint64_t> head_;
+  const Clock::time_point epoch_;
+  std::mutex names_mutex_;
+  std::set<std::string> names_;
+  // Open-addressed by name pointer; a slot is claimed by setting its name.
+  std::unique_ptr<Histogram[]> histograms_;
+};
+
+
+/**
+ * Records the lifetime of this object as a sample of a zone.
+ *
+ * Does nothing if there is no Profiler.
+ */
+class ProfileZone : boost::noncopyable {
+ public:
+  /// Record into Profiler::current().
+  explicit ProfileZone(const char *name) : ProfileZone(Profiler::current(), name) {}
+
+  ProfileZone(Profiler *profiler, const char *name)
+      : profiler_(profiler), name_(name), start_(profiler ? profiler->now() : 0) {}
+
+  ~ProfileZone() {
+    if (profiler_) {
+      profiler_->record(name_, start_, profiler_->now());
+    }
+  }
+
+ private:
+  Profiler *profiler_;
+  const char *name_;
+  uint64_t start_;
+};
+
+}  // namespace entityx
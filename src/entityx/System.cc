@@ -8,17 +8,250 @@
  * Author: Alec Thomas <alec@swapoff.org>
  */
 
+#include <cmath>
+#include <thread>
+#include <boost/bind.hpp>
 #include "entityx/System.h"
 
 namespace entityx {
 
 BaseSystem::Family BaseSystem::family_counter_;
+BaseResource::Family BaseResource::family_counter_ = 0;
+
+namespace {
+
+// Matches one in every `slices` entity indices.
+struct SlicePredicate {
+  SlicePredicate(uint32_t slice, uint32_t slices) : slice(slice), slices(slices) {}
+
+  bool operator()(const ptr<EntityManager> &, const Entity::Id &id) const {
+    return id.index() % slices == slice;
+  }
+
+  uint32_t slice, slices;
+};
+
+// Makes profiler, if any, this thread's Profiler::current() while in scope.
+struct CurrentProfiler {
+  explicit CurrentProfiler(Profiler *profiler) : outer(Profiler::current()) {
+    if (profiler) {
+      Profiler::current() = profiler;
+    }
+  }
+  ~CurrentProfiler() {
+    Profiler::current() = outer;
+  }
+
+  Profiler *outer;
+};
+
+}  // namespace
+
+EntityManager::View BaseSystem::slice(const EntityManager::View &view) const {
+  if (slices_ <= 1) {
+    return view;
+  }
+  return EntityManager::View(view, SlicePredicate(slice_, slices_));
+}
+
+void SystemManager::set_profiler(ptr<Profiler> profiler) {
+  profiler_ = profiler;
+  for (auto &node : nodes_) {
+    name_zones(*node);
+  }
+}
+
+void SystemManager::name_zones(Node &node) {
+  if (profiler_) {
+    node.zone = profiler_->intern(node.name);
+    node.configure_zone = profiler_->intern(node.name + "::configure");
+  }
+}
 
 void SystemManager::configure() {
-  for (auto pair : systems_) {
-    pair.second->configure(event_manager_);
+  for (auto &node : nodes_) {
+    ProfileZone zone(profiler_.get(), node->configure_zone);
+    node->system->configure(event_manager_);
   }
+  build_graph();
   initialized_ = true;
 }
 
+void SystemManager::set_worker_threads(size_t count) {
+  pool_.reset(count ? new TaskPool(count) : nullptr);
+}
+
+void SystemManager::build_graph() {
+  for (auto &node : nodes_) {
+    if (!node->declared) {
+      node->system->declare(node->access);
+      node->declared = true;
+    }
+    node->successors.clear();
+    node->predecessors = 0;
+  }
+  for (size_t i = 0; i < nodes_.size(); ++i) {
+    for (size_t j = i + 1; j < nodes_.size(); ++j) {
+      if (nodes_[i]->per_frame == nodes_[j]->per_frame && nodes_[i]->access.conflicts(nodes_[j]->access)) {
+        nodes_[i]->successors.push_back(j);
+        nodes_[j]->predecessors += 1;
+      }
+    }
+  }
+  graph_dirty_ = false;
+}
+
+void SystemManager::update_all(double dt) {
+  assert(initialized_ && "SystemManager::configure() not called");
+  // Events emitted and drained outside any System are timed too.
+  CurrentProfiler profiling(profiler_.get());
+  ProfileZone zone(profiler_.get(), "SystemManager::update_all");
+  if (graph_dirty_) {
+    build_graph();
+  }
+  run_phase(false, dt);
+  // Per-frame Systems see the simulation's queued events, eg. destroyed entities, first.
+  drain_events();
+  run_phase(true, dt);
+  drain_events();
+}
+
+int SystemManager::update_frame(double dt) {
+  assert(initialized_ && "SystemManager::configure() not called");
+  // Events emitted and drained outside any System are timed too.
+  CurrentProfiler profiling(profiler_.get());
+  ProfileZone zone(profiler_.get(), "SystemManager::update_frame");
+  if (graph_dirty_) {
+    build_graph();
+  }
+  accumulator_ += dt;
+  int steps = 0;
+  while (accumulator_ >= step_ && steps < max_steps_) {
+    run_phase(false, step_);
+    drain_events();
+    accumulator_ -= step_;
+    steps += 1;
+  }
+  if (accumulator_ >= step_) {
+    // Fell too far behind; keep only the partial step.
+    accumulator_ = std::fmod(accumulator_, step_);
+  }
+  event_manager_->emit<FixedStepEvent>(steps, step_, interpolation());
+  run_phase(true, dt);
+  drain_events();
+  return steps;
+}
+
+void SystemManager::drain_events() {
+  ProfileZone zone(profiler_.get(), "EventManager::drain");
+  event_manager_->drain();
+}
+
+void SystemManager::run_phase(bool per_frame, double dt) {
+  size_t count = 0;
+  for (auto &node : nodes_) {
+    if (node->per_frame == per_frame) {
+      count += 1;
+    }
+  }
+  if (!pool_ || count < 2) {
+    for (auto &node : nodes_) {
+      if (node->per_frame == per_frame) {
+        run(*node, dt);
+      }
+    }
+    return;
+  }
+  remaining_ = count;
+  for (auto &node : nodes_) {
+    node->waiting = node->predecessors;
+  }
+  size_t slot = pool_->external_slot();
+  for (size_t i = 0; i < nodes_.size(); ++i) {
+    if (nodes_[i]->per_frame == per_frame && nodes_[i]->predecessors == 0) {
+      pool_->submit(boost::bind(&SystemManager::run_from, this, i, _1, dt), slot);
+    }
+  }
+  // Help out until every System has run.
+  while (remaining_ > 0) {
+    if (!pool_->run_one(slot)) {
+      std::this_thread::yield();
+    }
+  }
+}
+
+void SystemManager::run(Node &node, double dt) {
+  if (node.interval > 1) {
+    node.skipped_dt += dt;
+    if (node.countdown > 0) {
+      node.countdown -= 1;
+      return;
+    }
+    node.countdown = node.interval - 1;
+    dt = node.skipped_dt;
+    node.skipped_dt = 0.0;
+  }
+  node.system->elapsed_ += dt;
+  if (node.slices > 1) {
+    // This slice last ran `slices` runs ago.
+    node.slice_dts[node.next_slice] = dt;
+    dt = 0.0;
+    for (double slice_dt : node.slice_dts) {
+      dt += slice_dt;
+    }
+    node.system->slice_ = node.next_slice;
+    node.system->slices_ = node.slices;
+    node.next_slice = (node.next_slice + 1) % node.slices;
+  }
+#ifdef ENTITYX_VALIDATE_SYSTEM_ACCESS
+  const SystemAccess *&current = SystemAccess::current();
+  const SystemAccess *previous = current;
+  current = &node.access;
+#endif
+  {
+    CurrentProfiler profiling(profiler_.get());
+    ProfileZone zone(profiler_.get(), node.zone);
+    node.system->update(entity_manager_, event_manager_, dt);
+  }
+#ifdef ENTITYX_VALIDATE_SYSTEM_ACCESS
+  current = previous;
+#endif
+}
+
+void SystemManager::run_from(size_t index, size_t slot, double dt) {
+  for (;;) {
+    Node &node = *nodes_[index];
+    run(node, dt);
+    // Carry on with one newly ready System ourselves and share out the rest,
+    // so a chain of conflicting Systems stays on one thread.
+    size_t next = nodes_.size();
+    for (size_t successor : node.successors) {
+      if (--nodes_[successor]->waiting == 0) {
+        if (next == nodes_.size()) {
+          next = successor;
+        } else {
+          pool_->submit(boost::bind(&SystemManager::run_from, this, successor, _1, dt), slot);
+        }
+      }
+    }
+    remaining_ -= 1;
+    if (next == nodes_.size()) {
+      return;
+    }
+    index = next;
+  }
+}
+
+#ifdef ENTITYX_VALIDATE_SYSTEM_ACCESS
+std::vector<std::string> SystemManager::access_violations() const {
+  std::vector<std::string> violations;
+  for (auto &node : nodes_) {
+    for (auto &violation : node->access.violations()) {
+      violations.push_back(node->name + ": " + violation);
+    }
+  }
+  return violations;
+}
+#endif
+
 }
@@ -14,10 +14,18 @@
 #include <boost/noncopyable.hpp>
 #include <boost/unordered_map.hpp>
 #include <stdint.h>
+#include <atomic>
 #include <cassert>
+#include <string>
+#include <typeinfo>
+#include <vector>
 #include "entityx/config.h"
 #include "entityx/Entity.h"
 #include "entityx/Event.h"
+#include "entityx/Profiler.h"
+#include "entityx/SystemAccess.h"
+#include "entityx/TaskPool.h"
+#include "entityx/TypeName.h"
 
 
 namespace entityx {
@@ -38,6 +46,15 @@ class BaseSystem : boost::noncopyable {
    */
   virtual void configure(ptr<EventManager> events) {}
 
+  /**
+   * Declare the components and resources update() reads and writes.
+   *
+   * Called once, after configure(). SystemManager::update_all() uses the
+   * declarations to run Systems concurrently. Systems that don't override
+   * this are exclusive and always run alone.
+   */
+  virtual void declare(SystemAccess &access) { access.exclusive(); }
+
   /**
    * Apply System behavior.
    *
@@ -48,6 +65,34 @@ class BaseSystem : boost::noncopyable {
   static Family family_counter_;
 
  protected:
+  /**
+   * Narrow view to the entities this update should handle.
+   *
+   * A System that SystemManager::set_slices() splits into N slices sees a
+   * different 1/N of its entities on each update, by entity index, and
+   * every entity once every N updates. Otherwise returns view unchanged.
+   *
+   *     for (auto entity : slice(entities->entities_with_components<Brain>())) {
+   *       ...
+   *     }
+   */
+  EntityManager::View slice(const EntityManager::View &view) const;
+
+  /**
+   * Total dt of this System's updates so far, including the current one.
+   *
+   * Counts each update once, however it is sliced. A sliced System can stamp
+   * entities with it as they appear and age them by the time since, instead
+   * of by a slice's dt, which may begin before they existed.
+   */
+  double elapsed() const { return elapsed_; }
+
+ private:
+  friend class SystemManager;
+
+  uint32_t slice_ = 0;
+  uint32_t slices_ = 1;
+  double elapsed_ = 0.0;
 };
 
 
@@ -72,6 +117,42 @@ class System : public BaseSystem {
 };
 
 
+/**
+ * Emitted by SystemManager::update_frame() after the fixed steps of a frame,
+ * before the per-frame Systems run.
+ *
+ * Per-frame Systems can use alpha to interpolate between the state after the
+ * previous step and the state after the latest one.
+ */
+struct FixedStepEvent : public Event<FixedStepEvent> {
+  FixedStepEvent(int steps, double step, double alpha) : steps(steps), step(step), alpha(alpha) {}
+
+  /// Fixed steps run this frame.
+  int steps;
+  /// Length of a step, in seconds.
+  double step;
+  /// How far time has advanced past the latest step, as a fraction of a step.
+  double alpha;
+};
+
+
+/**
+ * Owns the Systems and runs them.
+ *
+ * Systems can be updated one at a time with update<S>(), or all together with
+ * update_all(). update_all() runs Systems in the order they were added,
+ * except that Systems whose declared access doesn't conflict (see
+ * BaseSystem::declare()) may run at the same time on worker threads.
+ *
+ * update_frame() runs simulation Systems at a fixed step instead, as many
+ * times as the frame's time allows, then the Systems marked with
+ * set_per_frame() once:
+ *
+ *     systems.set_fixed_step(1.0 / 60.0);
+ *     systems.set_per_frame<RenderSystem>();
+ *     ...
+ *     systems.update_frame(dt);
+ */
 class SystemManager : boost::noncopyable, public enable_shared_from_this<SystemManager> {
  public:
   SystemManager(ptr<EntityManager> entity_manager,
@@ -96,6 +177,9 @@ class SystemManager : boost::noncopyable, public enable_shared_from_this<SystemM
   template <typename S>
   void add(ptr<S> system) {
     systems_.insert(std::make_pair(S::family(), system));
+    nodes_.push_back(ptr<Node>(new Node(system, type_name(typeid(S)))));
+    name_zones(*nodes_.back());
+    graph_dirty_ = true;
   }
 
   /**
@@ -131,14 +215,125 @@ class SystemManager : boost::noncopyable, public enable_shared_from_this<SystemM
 
   /**
    * Call the System::update() method for a registered system.
+   *
+   * Honours set_update_interval() and set_slices().
    */
   template <typename S>
   void update(double dt) {
     assert(initialized_ && "SystemManager::configure() not called");
-    ptr<S> s = system<S>();
-    s->update(entity_manager_, event_manager_, dt);
+    run(node_for(system<S>()), dt);
   }
 
+  /**
+   * Call System::update() on every registered System.
+   *
+   * A System runs after every earlier-added System whose access conflicts
+   * with its own, and otherwise may run concurrently with them. Without
+   * worker threads (see set_worker_threads()) this is the order they were
+   * added in.
+   *
+   * Events on queued channels are drained on the calling thread after the
+   * simulation Systems have run and again after the per-frame ones, so their
+   * receivers never race with a System. Until then a System may still hold
+   * handles to entities destroyed earlier in the update; check valid(). Events on
+   * other channels are delivered on the thread that emits them; Systems that
+   * may run concurrently should post() their events instead of emitting them.
+   */
+  void update_all(double dt);
+
+  /**
+   * Advance by one rendered frame of length dt.
+   *
+   * Adds dt to an accumulator and calls update() on every simulation System
+   * with the fixed step, once per whole step accumulated, draining queued
+   * events after each. If more than max_steps are owed, the surplus time is
+   * dropped so a slow frame can't snowball. Then emits a FixedStepEvent and
+   * updates the per-frame Systems once with dt.
+   *
+   * @returns Number of fixed steps run.
+   */
+  int update_frame(double dt);
+
+  /**
+   * Use a fixed step of `step` seconds in update_frame(), running at most
+   * max_steps of them per frame.
+   */
+  void set_fixed_step(double step, int max_steps = 5) {
+    assert(step > 0.0 && max_steps > 0);
+    step_ = step;
+    max_steps_ = max_steps;
+  }
+
+  /// Time accumulated towards the next fixed step, as a fraction of a step.
+  double interpolation() const { return accumulator_ / step_; }
+
+  /**
+   * Have update_frame() update S once per frame, after the fixed steps,
+   * rather than with them. update_all() updates per-frame Systems last.
+   */
+  template <typename S>
+  void set_per_frame(bool per_frame = true) {
+    node_for(system<S>()).per_frame = per_frame;
+    graph_dirty_ = true;
+  }
+
+  /**
+   * Update S only on every interval-th update, passing it the dt of the
+   * skipped updates added up. Systems with the same interval are staggered
+   * so they don't all land on the same update.
+   */
+  template <typename S>
+  void set_update_interval(int interval) {
+    assert(interval > 0);
+    Node &node = node_for(system<S>());
+    size_t index = 0;
+    while (nodes_[index].get() != &node) {
+      ++index;
+    }
+    node.interval = interval;
+    node.countdown = index % interval;
+  }
+
+  /**
+   * Split S's entities into slices and have each update handle the next one
+   * (see BaseSystem::slice()), passing it the dt since that slice last ran.
+   * Entities created since then haven't seen all of that; see
+   * BaseSystem::elapsed().
+   *
+   * Spreads work that doesn't need doing every update, like AI or expiry
+   * checks, evenly across updates.
+   */
+  template <typename S>
+  void set_slices(int slices) {
+    assert(slices > 0);
+    Node &node = node_for(system<S>());
+    node.slices = slices;
+    node.slice_dts.assign(slices, 0.0);
+    node.next_slice = 0;
+    // run() only assigns these while slicing; going back to one slice
+    // must hand the System all of its entities again.
+    node.system->slice_ = 0;
+    node.system->slices_ = 1;
+  }
+
+  /**
+   * Number of threads, besides the caller, that update_all() may use.
+   *
+   * Defaults to zero, which runs every System on the calling thread.
+   */
+  void set_worker_threads(size_t count);
+
+  /**
+   * Time every System's configure() and update(), and event delivery, into
+   * profiler. Set before configure() to include configure().
+   *
+   * During update_all() and update_frame(), and while a System runs,
+   * Profiler::current() is the profiler, so ProfileZones inside Systems and
+   * the EventManager's per-family delivery zones are recorded too. Zones are named by the
+   * profiler's own copies of System names, so it outlives this manager.
+   */
+  void set_profiler(ptr<Profiler> profiler);
+
   /**
    * Configure the system. Call after adding all Systems.
    *
@@ -146,11 +341,74 @@ class SystemManager : boost::noncopyable, public enable_shared_from_this<SystemM
    */
   void configure();
 
+#ifdef ENTITYX_VALIDATE_SYSTEM_ACCESS
+  /**
+   * Component reads and entity changes made by Systems during update<S>() or
+   * update_all() that they didn't declare, as "<System>: <access>".
+   */
+  std::vector<std::string> access_violations() const;
+#endif
+
  private:
+  // A System and its place in the update_all() graph.
+  struct Node {
+    Node(ptr<BaseSystem> system, const std::string &name)
+        : system(system), name(name), waiting(0) {}
+
+    ptr<BaseSystem> system;
+    std::string name;
+    // Zone names interned by the Profiler, if there is one.
+    const char *zone = nullptr;
+    const char *configure_zone = nullptr;
+    SystemAccess access;
+    bool declared = false;
+    bool per_frame = false;
+    // Reduced rate: run when countdown reaches zero, with the dt skipped so far.
+    int interval = 1;
+    int countdown = 0;
+    double skipped_dt = 0.0;
+    // Time slicing: dt of the last `slices` runs, one per slice.
+    int slices = 1;
+    int next_slice = 0;
+    std::vector<double> slice_dts;
+    // Later Systems in the same phase that conflict with this one.
+    std::vector<size_t> successors;
+    size_t predecessors = 0;
+    // Predecessors yet to finish in the current update_all().
+    std::atomic<size_t> waiting;
+  };
+
+  Node &node_for(const ptr<BaseSystem> &system) {
+    for (auto &node : nodes_) {
+      if (node->system == system) {
+        return *node;
+      }
+    }
+    assert(false && "System not added to this SystemManager");
+    return *nodes_.front();
+  }
+
+  void name_zones(Node &node);
+  void build_graph();
+  // Update every System in one phase: simulation or per-frame.
+  void run_phase(bool per_frame, double dt);
+  void run(Node &node, double dt);
+  void run_from(size_t index, size_t slot, double dt);
+  void drain_events();
+
   bool initialized_ = false;
   ptr<EntityManager> entity_manager_;
   ptr<EventManager> event_manager_;
   boost::unordered_map<BaseSystem::Family, ptr<BaseSystem>> systems_;
+  // In the order they were added.
+  std::vector<ptr<Node>> nodes_;
+  bool graph_dirty_ = false;
+  ptr<TaskPool> pool_;
+  ptr<Profiler> profiler_;
+  double step_ = 1.0 / 60.0;
+  int max_steps_ = 5;
+  double accumulator_ = 0.0;
+  std::atomic<size_t> remaining_{0};
 };
 
 }  // namespace entityx
@@ -0,0 +1,211 @@
+/*
+ * Copyright (C) 2012 Alec Thomas <alec@swapoff.org>
+ * All rights reserved.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution.
+ *
+ * Author: Alec Thomas <alec@swapoff.org>
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <bitset>
+#include <cassert>
+#include <string>
+#include <type_traits>
+#include <typeinfo>
+#include <vector>
+#include "entityx/config.h"
+#ifdef ENTITYX_VALIDATE_SYSTEM_ACCESS
+#include "entityx/TypeName.h"
+#endif
+
+namespace entityx {
+
+class BaseComponent;
+
+static const uint64_t MAX_RESOURCES = 64;
+
+/// One bit per Resource family.
+typedef std::bitset<MAX_RESOURCES> ResourceMask;
+
+
+/**
+ * Base class for resources. Generally should not be directly used, instead see Resource<Derived>.
+ */
+struct BaseResource {
+ public:
+  typedef uint64_t Family;
+
+ protected:
+  static Family family_counter_;
+};
+
+
+/**
+ * A tag naming something Systems share other than components, such as a
+ * physics world or the GL context, so it can appear in a SystemAccess.
+ *
+ *     struct PhysicsWorld : Resource<PhysicsWorld> {};
+ *
+ *     access.writes<PhysicsWorld>();
+ */
+template <typename Derived>
+struct Resource : public BaseResource {
+ public:
+  static Family family() {
+    static Family family = family_counter_++;
+    assert(family < MAX_RESOURCES);
+    return family;
+  }
+};
+
+
+/**
+ * The set of entities and their component masks.
+ *
+ * Creating or destroying entities, and assigning or removing components,
+ * writes Entities. Any component access implies reading it.
+ */
+struct Entities : public Resource<Entities> {};
+
+
+/**
+ * The components and resources a System reads and writes.
+ *
+ * Filled in by BaseSystem::declare(). SystemManager::update_all() runs two
+ * Systems at the same time only if neither writes something the other uses.
+ *
+ *     void declare(SystemAccess &access) override {
+ *       access.reads<Position>().writes<Velocity>();
+ *     }
+ *
+ * When built with ENTITYX_VALIDATE_SYSTEM_ACCESS, the EntityManager records
+ * every component access and entity change a running System makes without
+ * having declared it; see SystemManager::access_violations().
+ */
+class SystemAccess {
+ public:
+  /// Declare that the System reads each component or resource.
+  template <typename T, typename ... Ts>
+  SystemAccess &reads() {
+    int marks[] = { (mark<T>(reads_), 0), (mark<Ts>(reads_), 0) ... };
+    (void)marks;
+    return *this;
+  }
+
+  /// Declare that the System writes (and possibly reads) each component or resource.
+  template <typename T, typename ... Ts>
+  SystemAccess &writes() {
+    int marks[] = { (mark<T>(writes_), 0), (mark<Ts>(writes_), 0) ... };
+    (void)marks;
+    return *this;
+  }
+
+  /// Declare that the System may touch anything. It will always run alone.
+  SystemAccess &exclusive() {
+    exclusive_ = true;
+    return *this;
+  }
+
+  bool is_exclusive() const { return exclusive_; }
+
+  /// True if the two Systems must not run at the same time.
+  bool conflicts(const SystemAccess &other) const {
+    if (exclusive_ || other.exclusive_) {
+      return true;
+    }
+    Masks mine = uses(), theirs = other.uses();
+    return (writes_.components & theirs.components).any()
+        || (writes_.resources & theirs.resources).any()
+        || (other.writes_.components & mine.components).any()
+        || (other.writes_.resources & mine.resources).any();
+  }
+
+#ifdef ENTITYX_VALIDATE_SYSTEM_ACCESS
+  /// The declaration of the System running on this thread, if any.
+  static const SystemAccess *&current() {
+    static thread_local const SystemAccess *access = nullptr;
+    return access;
+  }
+
+  /// Record C being read by the current System, if it didn't declare it.
+  template <typename C>
+  static void check_read() {
+    const SystemAccess *access = current();
+    if (access && !access->exclusive_ && !access->uses().components.test(C::family())) {
+      access->violate(C::family(), typeid(C), "reads undeclared component ");
+    }
+  }
+
+  /// Record the current System changing entities, if it didn't declare it.
+  static void check_structure() {
+    const SystemAccess *access = current();
+    if (access && !access->exclusive_ && !access->writes_.resources.test(Entities::family())) {
+      access->violate(MAX_COMPONENTS, typeid(Entities), "changes entities without writing ");
+    }
+  }
+
+  /// Undeclared accesses recorded so far, one message per kind of access.
+  const std::vector<std::string> &violations() const { return violations_; }
+  void clear_violations() {
+    violated_.reset();
+    violations_.clear();
+  }
+#endif
+
+ private:
+  struct Masks {
+    ComponentMask components;
+    ResourceMask resources;
+  };
+
+  template <typename T>
+  static void mark(Masks &masks) {
+    mark<T>(masks, std::is_base_of<BaseResource, T>());
+  }
+
+  template <typename T>
+  static void mark(Masks &masks, std::true_type) {
+    masks.resources.set(T::family());
+  }
+
+  template <typename T>
+  static void mark(Masks &masks, std::false_type) {
+    static_assert(std::is_base_of<BaseComponent, T>::value, "SystemAccess takes Components and Resources");
+    masks.components.set(T::family());
+  }
+
+  // Everything read or written; touching any component reads Entities.
+  Masks uses() const {
+    Masks masks;
+    masks.components = reads_.components | writes_.components;
+    masks.resources = reads_.resources | writes_.resources;
+    if (masks.components.any()) {
+      masks.resources.set(Entities::family());
+    }
+    return masks;
+  }
+
+#ifdef ENTITYX_VALIDATE_SYSTEM_ACCESS
+  // Only ever called from the thread running this System.
+  void violate(size_t bit, const std::type_info &what, const char *message) const {
+    if (!violated_.test(bit)) {
+      violated_.set(bit);
+      violations_.push_back(message + type_name(what));
+    }
+  }
+
+  // One bit per component, plus one for entity changes.
+  mutable std::bitset<MAX_COMPONENTS + 1> violated_;
+  mutable std::vector<std::string> violations_;
+#endif
+
+  Masks reads_;
+  Masks writes_;
+  bool exclusive_ = false;
+};
+
+}  // namespace entityx
@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2012 Alec Thomas <alec@swapoff.org>
+ * All rights reserved.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution.
+ *
+ * Author: Alec Thomas <alec@swapoff.org>
+ */
+
+#include "entityx/TaskPool.h"
+
+namespace entityx {
+
+TaskPool::TaskPool(size_t threads) : queued_(0) {
+  for (size_t i = 0; i < threads + 1; ++i) {
+    slots_.push_back(ptr<Slot>(new Slot()));
+  }
+  for (size_t i = 0; i < threads; ++i) {
+    threads_.emplace_back(&TaskPool::work, this, i);
+  }
+}
+
+TaskPool::~TaskPool() {
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+    stop_ = true;
+  }
+  wake_.notify_all();
+  for (auto &thread : threads_) {
+    thread.join();
+  }
+}
+
+void TaskPool::submit(const Task &task, size_t slot) {
+  {
+    std::lock_guard<std::mutex> lock(slots_[slot]->mutex);
+    slots_[slot]->tasks.push_back(task);
+  }
+  {
+    // Count under the sleep lock so a worker can't miss the wake-up.
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+    queued_ += 1;
+  }
+  wake_.notify_one();
+}
+
+bool TaskPool::run_one(size_t slot) {
+  Task task;
+  if (!take(slot, task)) {
+    return false;
+  }
+  task(slot);
+  return true;
+}
+
+bool TaskPool::take(size_t slot, Task &task) {
+  if (queued_ == 0) {
+    return false;
+  }
+  {
+    // Newest of our own first; it is most likely still in cache.
+    Slot &own = *slots_[slot];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (!own.tasks.empty()) {
+      task.swap(own.tasks.back());
+      own.tasks.pop_back();
+      queued_ -= 1;
+      return true;
+    }
+  }
+  for (size_t i = 1; i < slots_.size(); ++i) {
+    Slot &other = *slots_[(slot + i) % slots_.size()];
+    std::lock_guard<std::mutex> lock(other.mutex);
+    if (!other.tasks.empty()) {
+      task.swap(other.tasks.front());
+      other.tasks.pop_front();
+      queued_ -= 1;
+      return true;
+    }
+  }
+  return false;
+}
+
+void TaskPool::work(size_t slot) {
+  for (;;) {
+    if (run_one(slot)) {
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(sleep_mutex_);
+    wake_.wait(lock, [this] { return queued_ > 0 || stop_; });
+    if (stop_) {
+      return;
+    }
+  }
+}
+
+}  // namespace entityx
@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2012 Alec Thomas <alec@swapoff.org>
+ * All rights reserved.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution.
+ *
+ * Author: Alec Thomas <alec@swapoff.org>
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include "entityx/config.h"
+
+namespace entityx {
+
+/**
+ * A fixed set of worker threads that steal work from each other.
+ *
+ * Every thread owns a slot with its own deque of tasks. A thread runs the
+ * newest task in its own slot first and otherwise takes the oldest task
+ * from another slot. The thread that owns the pool gets the last slot,
+ * external_slot(), and can help with run_one() while it waits.
+ *
+ * Used by SystemManager::update_all(); there is usually no need to use it directly.
+ */
+class TaskPool : boost::noncopyable {
+ public:
+  /// A task is told the slot of the thread running it, for submitting follow-up work.
+  typedef boost::function<void (size_t slot)> Task;
+
+  explicit TaskPool(size_t threads);
+  ~TaskPool();
+
+  /// Number of worker threads, not counting the owning thread.
+  size_t size() const { return threads_.size(); }
+
+  /// Slot of the thread that owns the pool.
+  size_t external_slot() const { return slots_.size() - 1; }
+
+  /// Queue a task on a slot. Call with the slot of the calling thread.
+  void submit(const Task &task, size_t slot);
+
+  /**
+   * Run one queued task on the calling thread, if there is any.
+   *
+   * @returns false if there was nothing to run.
+   */
+  bool run_one(size_t slot);
+
+ private:
+  struct Slot {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  bool take(size_t slot, Task &task);
+  void work(size_t slot);
+
+  std::vector<ptr<Slot>> slots_;
+  std::vector<std::thread> threads_;
+  // Tasks submitted but not yet taken; workers sleep while it is zero.
+  std::atomic<size_t> queued_;
+  std::mutex sleep_mutex_;
+  std::condition_variable wake_;
+  bool stop_ = false;
+};
+
+}  // namespace entityx
@@ -1,14 +1,27 @@
 #pragma once
 
 #include <stdint.h>
+#include <bitset>
 #include "entityx/config.h"
 
 namespace entityx {
 
 static const uint64_t MAX_COMPONENTS = 64;
 
+/// One bit per Component family.
+typedef std::bitset<MAX_COMPONENTS> ComponentMask;
+
 }  // namespace entityx
 
+// Define ENTITYX_INSTRUMENT_EVENTS to have the EventManager count events and
+// time receivers (see EventManager::stats()). Costs nothing when undefined.
+// #define ENTITYX_INSTRUMENT_EVENTS
+
+// Define ENTITYX_VALIDATE_SYSTEM_ACCESS to have the EntityManager report
+// component reads and entity changes that the running System didn't declare
+// (see SystemManager::access_violations()). Costs nothing when undefined.
+// #define ENTITYX_VALIDATE_SYSTEM_ACCESS
+
 #include <memory>
 
 namespace entityx {
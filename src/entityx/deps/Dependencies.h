@@ -35,6 +35,9 @@ public:
     events->subscribe<ComponentAddedEvent<C>>(*this);
   }
 
+  // All the work happens in receive(), so update() never conflicts with anything.
+  virtual void declare(SystemAccess &access) override {}
+
   virtual void update(ptr<EntityManager> entities, ptr<EventManager> events, double dt) override {}
 
 private:
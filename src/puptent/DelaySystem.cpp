@@ -31,7 +31,7 @@ using namespace puptent;
 
 void DelaySystem::update( EntityManagerRef es, EventManagerRef events, double dt )
 {
-  for( auto entity : es->entities_with_components<DelayActionComponent>() )
+  for( auto entity : slice( es->entities_with_components<DelayActionComponent>() ) )
   {
     auto action = entity.component<DelayActionComponent>();
     action->time -= dt;
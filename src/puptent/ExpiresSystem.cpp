@@ -30,12 +30,25 @@
 using namespace puptent;
 using namespace std;
 
+void ExpiresSystem::configure( EventManagerRef events )
+{
+  events->subscribe<ComponentAddedEvent<Expires>>( *this );
+}
+
+void ExpiresSystem::receive( const ComponentAddedEvent<Expires> &event )
+{
+  event.component->mCountedTo = elapsed();
+}
+
 void ExpiresSystem::update(shared_ptr<entityx::EntityManager> es, shared_ptr<entityx::EventManager> events, double dt)
 {
-  for( auto entity : es->entities_with_components<Expires>() )
+  const double now = elapsed();
+  for( auto entity : slice( es->entities_with_components<Expires>() ) )
   {
     auto expires = entity.component<Expires>();
-    expires->time -= dt;
+    // the time since we last counted, which is less than dt if added since this slice last ran
+    expires->time -= now - expires->mCountedTo;
+    expires->mCountedTo = now;
     if( expires->time <= 0.0 )
     {
       if( expires->callback ){ expires->callback(); }
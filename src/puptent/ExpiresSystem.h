@@ -47,15 +47,27 @@ namespace puptent
     {}
     double                  time;
     std::function<void ()>  callback;
+  private:
+    friend struct ExpiresSystem;
+    //! ExpiresSystem::elapsed() when time was last counted down, or when we were added
+    double                  mCountedTo = 0.0;
   };
 
   /**
    ExpiresSystem:
    Destroys an entity once the time in Expires runs out.
+   Can be time-sliced with SystemManager::set_slices(); entities then expire
+   up to a few updates late, with the right amount of time counted down.
+   Each Expires counts down from when it was added, not from when its slice
+   last ran, so new entities never expire early.
    */
   struct ExpiresSystem : public System<ExpiresSystem>, Receiver<ExpiresSystem>
   {
+    void configure( EventManagerRef events ) override;
+    //! expiry callbacks may do anything, so we run alone
+    void declare( SystemAccess &access ) override { access.exclusive(); }
     void update( EntityManagerRef es, EventManagerRef events, double dt ) override;
-  private:
+    //! start counting down from now
+    void receive( const ComponentAddedEvent<Expires> &event );
   };
 }
@@ -4,7 +4,10 @@
 //
 
 #include "puptent/KeyboardInput.h"
+#include "cinder/app/KeyEvent.h"
+#ifndef PUPTENT_HEADLESS
 #include "cinder/app/Window.h"
+#endif
 #include "pockets/CollectionUtilities.hpp"
 
 using namespace cinder;
@@ -23,15 +26,16 @@ KeyboardInputRef KeyboardInput::create()
   return KeyboardInputRef{ new KeyboardInput };
 }
 
+#ifndef PUPTENT_HEADLESS
 void KeyboardInput::connect( ci::app::WindowRef window )
 {
   mConnections.store( window->getSignalKeyDown().connect(
   [this]( const KeyEvent &event ) {
-    mDownEvents.emplace_back( event );
+    mDownEvents.push_back( event.getCode() );
   } ) );
   mConnections.store( window->getSignalKeyUp().connect(
   [this]( const KeyEvent &event ) {
-    mUpEvents.emplace_back( event );
+    mUpEvents.push_back( event.getCode() );
   } ) );
   // connect update at front to guarantee most recent events are used in scripts
   mConnections.store( App::get()->getSignalUpdate().connect(
@@ -40,19 +44,23 @@ void KeyboardInput::connect( ci::app::WindowRef window )
   },
   signals::at_front ) );
 }
+#endif
 
 void KeyboardInput::update()
 {
   mPressedKeys.clear();
   mReleasedKeys.clear();
-  for( const auto &event : mDownEvents )
+  for( const auto key : mDownEvents )
   {
-    keyDown( event );
+    keyDown( key );
   }
-  for( const auto &event : mUpEvents )
+  for( const auto key : mUpEvents )
   {
-    keyUp( event );
+    keyUp( key );
   }
+  // keep what we applied around for recording
+  mLastDown.swap( mDownEvents );
+  mLastUp.swap( mUpEvents );
   mUpEvents.clear();
   mDownEvents.clear();
   // update directional forces
@@ -79,16 +87,17 @@ void KeyboardInput::update()
   }
 }
 
-void KeyboardInput::keyDown( const KeyEvent &event )
+void KeyboardInput::keyDown( int key )
 {
-  mPressedKeys.insert( event.getCode() );
-  mHeldKeys.push_back( event.getCode() );
+  mPressedKeys.insert( key );
+  mLatchedKeys.insert( key );
+  mHeldKeys.push_back( key );
 }
 
-void KeyboardInput::keyUp( const ci::app::KeyEvent &event )
+void KeyboardInput::keyUp( int key )
 {
-  mReleasedKeys.insert( event.getCode() );
-  pk::vector_remove( &mHeldKeys, event.getCode() );
+  mReleasedKeys.insert( key );
+  pk::vector_remove( &mHeldKeys, key );
 }
 
 bool KeyboardInput::getKeyDown(int key) const
@@ -101,6 +110,11 @@ bool KeyboardInput::getKeyPressed(int key) const
   return mPressedKeys.find( key ) != mPressedKeys.end();
 }
 
+bool KeyboardInput::takeKeyPressed( int key )
+{
+  return mLatchedKeys.erase( key ) > 0;
+}
+
 bool KeyboardInput::getKeyReleased( int key ) const
 {
   return mReleasedKeys.find( key ) != mReleasedKeys.end();
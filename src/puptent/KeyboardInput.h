@@ -4,7 +4,9 @@
 //
 
 #pragma once
+#ifndef PUPTENT_HEADLESS
 #include "pockets/ConnectionManager.h"
+#endif
 #include <set>
 
 /**
@@ -26,12 +28,24 @@ namespace puptent
   public:
     KeyboardInput();
     ~KeyboardInput();
+#ifndef PUPTENT_HEADLESS
     //! connect to keyboard events for given window and start updating
     void connect( ci::app::WindowRef window );
     //! stop receiving input (also stops reporting keys and force)
     void pause(){ mConnections.block(); mHeldKeys.clear(); }
     //! resume receiving input
     void resume(){ mConnections.resume(); }
+#endif
+    //! apply the key events received since the last update
+    //! called at the start of every App update once connected; call it yourself otherwise
+    void update();
+    //! queue a key event by code, as if it came from a window; used to replay recorded input
+    void queueKeyDown( int key ){ mDownEvents.push_back( key ); }
+    void queueKeyUp( int key ){ mUpEvents.push_back( key ); }
+    //! key codes pressed by the last update, in the order they arrived
+    const std::vector<int>& getLastKeysDown() const { return mLastDown; }
+    //! key codes released by the last update, in the order they arrived
+    const std::vector<int>& getLastKeysUp() const { return mLastUp; }
 
     //! returns normalized force along xy axes
     auto getForce() -> ci::Vec2f const { return mForce; }
@@ -39,21 +53,29 @@ namespace puptent
     bool getKeyDown( int key ) const;
     //! returns true if the key with code key was pressed this frame
     bool getKeyPressed( int key ) const;
+    //! returns true once for each key with code key pressed since it was last taken
+    //! use from fixed-step scripts, which may run several times or not at all per frame
+    bool takeKeyPressed( int key );
     //! returns true if the key with code key was released this frame
     bool getKeyReleased( int key ) const;
     //! creates a new KeyboardInputRef
     static auto create() -> KeyboardInputRef;
   private:
+#ifndef PUPTENT_HEADLESS
     pk::ConnectionManager           mConnections;
+#endif
     ci::Vec2f                       mForce = ci::Vec2f::zero();
     std::vector<int>                mHeldKeys;
     std::set<int>                   mPressedKeys;
     std::set<int>                   mReleasedKeys;
-    std::vector<ci::app::KeyEvent>  mDownEvents;
-    std::vector<ci::app::KeyEvent>  mUpEvents;
+    std::set<int>                   mLatchedKeys;
+    // key codes waiting for the next update, and those it applied
+    std::vector<int>                mDownEvents;
+    std::vector<int>                mUpEvents;
+    std::vector<int>                mLastDown;
+    std::vector<int>                mLastUp;
 
-    void keyDown( const ci::app::KeyEvent &event );
-    void keyUp( const ci::app::KeyEvent &event );
-    void update();
+    void keyDown( int key );
+    void keyUp( int key );
   };
 }
\ No newline at end of file
@@ -26,44 +26,160 @@
  */
 
 #include "Locus.h"
+#include <atomic>
 
 using namespace puptent;
 using namespace cinder;
 
+namespace
+{
+  // source of cache revisions, so a cache built for one parent never matches another's
+  std::atomic<uint64_t> sRevisions{ 0 };
+  // source of ReadScope ids, unique across threads
+  std::atomic<uint64_t> sScopes{ 0 };
+  // this thread's open ReadScope, if any, and how deeply its scopes are nested
+  thread_local uint64_t sScope = 0;
+  thread_local int      sScopeDepth = 0;
+
+  // interpolate rotations along the shorter arc, so crossing 0/2π doesn't spin the long way round
+  float lerpAngle( float from, float to, float alpha )
+  {
+    const float tau = (float)M_PI * 2;
+    float delta = to - from;
+    delta -= tau * math<float>::floor( delta / tau + 0.5f );
+    return from + delta * alpha;
+  }
+}
+
+Locus::ReadScope::ReadScope()
+{
+  if( sScopeDepth++ == 0 ){ sScope = ++sScopes; }
+}
+
+Locus::ReadScope::~ReadScope()
+{
+  if( --sScopeDepth == 0 ){ sScope = 0; }
+}
+
 MatrixAffine2f Locus::toMatrix() const
 {
-  MatrixAffine2f mat;
-  mat.translate( position + registration_point );
-  mat.rotate( rotation );
-  mat.scale( scale );
-  mat.translate( -registration_point );
-  if( parent ){ mat = parent->toMatrix() * mat; }
-  return mat;
+  return world().matrix;
+}
+
+MatrixAffine2f Locus::toMatrix( float alpha ) const
+{
+  return interpolated( alpha ).matrix;
+}
+
+const Locus::WorldCache& Locus::world() const
+{
+  if( sScope && mWorld.scope == sScope ){ return mWorld; }
+  return refresh( mWorld, position, rotation, scale, parent ? &parent->world() : nullptr );
+}
+
+const Locus::WorldCache& Locus::interpolated( float alpha ) const
+{
+  if( sScope && mInterpolated.scope == sScope ){ return mInterpolated; }
+  const WorldCache *parent_cache = parent ? &parent->interpolated( alpha ) : nullptr;
+  if( mHasPrevious && alpha < 1.0f )
+  {
+    return refresh( mInterpolated, lerp( mPreviousPosition, position, alpha ), lerpAngle( mPreviousRotation, rotation, alpha ), lerp( mPreviousScale, scale, alpha ), parent_cache );
+  }
+  return refresh( mInterpolated, position, rotation, scale, parent_cache );
+}
+
+const Locus::WorldCache& Locus::refresh( WorldCache &cache, const Vec2f &pos, float rot, float s, const WorldCache *parent_cache ) const
+{
+  uint64_t parent_revision = parent_cache ? parent_cache->revision : 0;
+  if( cache.revision == 0
+     || cache.local_position != pos || cache.local_rotation != rot || cache.local_scale != s
+     || cache.local_registration != registration_point
+     || cache.parent != parent.get() || cache.parent_revision != parent_revision )
+  {
+    if( cache.revision == 0 || cache.local_rotation != rot || cache.local_scale != s )
+    { // moving without turning or scaling needs no trig
+      cache.local_axis = Vec2f{ math<float>::cos( rot ), math<float>::sin( rot ) } * s;
+    }
+    cache.matrix = localMatrix( pos, cache.local_axis );
+    cache.position = pos;
+    cache.rotation = rot;
+    cache.scale = s;
+    if( parent_cache )
+    {
+      cache.matrix = parent_cache->matrix * cache.matrix;
+      cache.position = parent_cache->matrix.transformPoint( pos );
+      cache.rotation += parent_cache->rotation;
+      cache.scale *= parent_cache->scale;
+    }
+    cache.local_position = pos;
+    cache.local_registration = registration_point;
+    cache.local_rotation = rot;
+    cache.local_scale = s;
+    cache.parent = parent.get();
+    cache.parent_revision = parent_revision;
+    cache.revision = ++sRevisions;
+  }
+  // a clean cache is only written to stamp it as checked in this thread's scope
+  if( sScope && cache.scope != sScope ){ cache.scope = sScope; }
+  return cache;
+}
+
+MatrixAffine2f Locus::localMatrix( const Vec2f &pos, const Vec2f &axis ) const
+{ // translate( pos + registration ) * rotate( rot ) * scale( s ) * translate( -registration ), multiplied out
+  float c = axis.x;
+  float n = axis.y;
+  const Vec2f &r = registration_point;
+  Vec2f origin = pos + r - Vec2f{ c * r.x - n * r.y, n * r.x + c * r.y };
+  return MatrixAffine2f( c, n, -n, c, origin.x, origin.y );
+}
+
+void Locus::recordStep()
+{
+  mPreviousPosition = position;
+  mPreviousRotation = rotation;
+  mPreviousScale = scale;
+  mHasPrevious = true;
 }
 
 float Locus::getScale() const
 {
-  return parent ? parent->getScale() * scale : scale;
+  return world().scale;
 }
 
 float Locus::getRotation() const
 {
-  return parent ? parent->getRotation() + rotation : rotation;
+  return world().rotation;
 }
 
 Vec2f Locus::getPosition() const
 {
-  return parent ? parent->toMatrix().transformPoint( position ) : position;
+  return world().position;
 }
 
 void Locus::detachFromParent()
 {
   if( parent )
   {
-    scale *= parent->getScale();
-    rotation += parent->getRotation();
-    position = parent->toMatrix().transformPoint( position );
+    const WorldCache &cache = world();
+    scale = cache.scale;
+    rotation = cache.rotation;
+    position = cache.position;
 
     parent.reset();
+    // previous step was in our parent's space
+    mHasPrevious = false;
+  }
+}
+
+void LocusHistorySystem::declare( SystemAccess &access )
+{
+  access.writes<Locus>();
+}
+
+void LocusHistorySystem::update( EntityManagerRef es, EventManagerRef events, double dt )
+{
+  for( auto entity : es->entities_with_components<Locus>() )
+  {
+    entity.component<Locus>()->recordStep();
   }
 }
@@ -38,6 +38,23 @@ namespace puptent
    Used by RenderSystem to transform RenderMesh component vertices
    Updated by movement systems (Physics, Custom Motion)
    No assumption is made about the units used
+
+   World transforms are cached: reading one compares our properties and our
+   parent's cache revision against those it was built from, and only
+   recomputes if something changed.
+
+   Caches are validated on read rather than marked dirty on write, because
+   properties are plain fields that systems and scripts assign directly; a
+   dirty flag would miss every write that didn't go through a setter.
+   The price is that a read outside a ReadScope walks up to the root,
+   comparing (but not recomputing) each ancestor: O(depth). Within a
+   ReadScope, where no locus changes, each locus is checked once and further
+   reads are O(1), so anything reading many loci (eg. RenderSystem) should
+   open one. The remaining reads, eg. scripts and new Particles, are few.
+
+   Reading a clean cache outside a ReadScope writes nothing; within one it
+   only stamps the cache as checked. Reading a stale cache rebuilds it, so
+   systems that read loci should still declare that they write them.
   */
   struct Locus : Component<Locus>
   {
@@ -62,7 +79,68 @@ namespace puptent
     std::shared_ptr<Locus> parent = nullptr;
     //! returns a matrix that will transform points based on Locus properties
     ci::MatrixAffine2f  toMatrix() const;
+    //! returns toMatrix() as it was \a alpha of the way from the last recorded step to now
+    ci::MatrixAffine2f  toMatrix( float alpha ) const;
+    //! changes whenever toMatrix() does; for caching things derived from it
+    uint64_t          revision() const { return world().revision; }
+    //! changes whenever toMatrix( alpha ) does
+    uint64_t          revision( float alpha ) const { return interpolated( alpha ).revision; }
+    //! remember current properties as the previous step's; see LocusHistorySystem
+    void              recordStep();
     //! remove parent after composing its transform into our own
     void              detachFromParent();
+    //! while one exists, promise not to change any locus (or the interpolation alpha)
+    //! scopes are per-thread; nested scopes share the outermost one
+    struct ReadScope
+    {
+      ReadScope();
+      ~ReadScope();
+      ReadScope( const ReadScope& ) = delete;
+      ReadScope& operator=( const ReadScope& ) = delete;
+    };
+  private:
+    //! a world transform and the local properties and parent it was built from
+    struct WorldCache
+    {
+      ci::MatrixAffine2f  matrix;
+      ci::Vec2f           position = ci::Vec2f::zero();
+      float               rotation = 0.0f;
+      float               scale = 1.0f;
+      ci::Vec2f           local_position = ci::Vec2f::zero();
+      ci::Vec2f           local_registration = ci::Vec2f::zero();
+      float               local_rotation = 0.0f;
+      float               local_scale = 1.0f;
+      //! ( cos( local_rotation ), sin( local_rotation ) ) * local_scale
+      ci::Vec2f           local_axis = ci::Vec2f( 1.0f, 0.0f );
+      const Locus         *parent = nullptr;
+      uint64_t            parent_revision = 0;
+      //! unique among all caches; zero until built
+      uint64_t            revision = 0;
+      //! the ReadScope it was last checked in; ids are unique across threads
+      uint64_t            scope = 0;
+    };
+    const WorldCache&   world() const;
+    const WorldCache&   interpolated( float alpha ) const;
+    const WorldCache&   refresh( WorldCache &cache, const ci::Vec2f &pos, float rot, float s, const WorldCache *parent_cache ) const;
+    //! \a axis is the local x axis: ( cos( rotation ), sin( rotation ) ) * scale
+    ci::MatrixAffine2f  localMatrix( const ci::Vec2f &pos, const ci::Vec2f &axis ) const;
+    mutable WorldCache  mWorld;
+    mutable WorldCache  mInterpolated;
+    // properties at the last recorded step, for interpolation
+    ci::Vec2f         mPreviousPosition = ci::Vec2f::zero();
+    float             mPreviousRotation = 0.0f;
+    float             mPreviousScale = 1.0f;
+    bool              mHasPrevious = false;
+  };
+
+  /**
+   LocusHistorySystem:
+   Records every Locus before each fixed step so RenderSystem can interpolate
+   between steps. Add it before any system that moves loci.
+   */
+  struct LocusHistorySystem : public System<LocusHistorySystem>
+  {
+    void declare( SystemAccess &access ) override;
+    void update( EntityManagerRef es, EventManagerRef events, double dt ) override;
   };
 }
@@ -45,7 +45,9 @@ void ParticleSystem::configure( EventManagerRef events )
   events->subscribe<ComponentRemovedEvent<Particle>>( *this );
   events->subscribe<ComponentAddedEvent<ParticleEmitter>>( *this );
   events->subscribe<ComponentRemovedEvent<ParticleEmitter>>( *this );
-  events->subscribe<EntityDestroyedEvent>( *this );
+  // only hear about entities we track; an entity with both is simply removed twice
+  events->subscribe_batch<EntityDestroyedEvent>( *this, EventFilter::components<Particle>() );
+  events->subscribe_batch<EntityDestroyedEvent>( *this, EventFilter::components<ParticleEmitter>() );
 }
 
 void ParticleSystem::receive( const ComponentAddedEvent<Particle> &event )
@@ -68,23 +70,32 @@ void ParticleSystem::receive( const ComponentRemovedEvent<ParticleEmitter> &even
   vector_remove( &mEmitters, event.entity );
 }
 
-void ParticleSystem::receive( const EntityDestroyedEvent &event )
-{
-  auto entity = event.entity;
-  if( entity.component<ParticleEmitter>() )
-  {
-    vector_remove( &mEmitters, entity );
-  }
-  if( entity.component<Particle>() )
+void ParticleSystem::receive( span<const EntityDestroyedEvent> events )
+{ // entities may already be gone if the channel is queued, so match on id alone
+  mDestroyed.clear();
+  for( const auto &event : events )
   {
-    vector_remove( &mParticles, entity );
+    mDestroyed.push_back( event.entity.id() );
   }
+  std::sort( mDestroyed.begin(), mDestroyed.end() );
+  auto destroyed = [this]( const Entity &entity ) {
+    return std::binary_search( mDestroyed.begin(), mDestroyed.end(), entity.id() );
+  };
+  mEmitters.erase( std::remove_if( mEmitters.begin(), mEmitters.end(), destroyed ), mEmitters.end() );
+  mParticles.erase( std::remove_if( mParticles.begin(), mParticles.end(), destroyed ), mParticles.end() );
+}
+
+void ParticleSystem::declare( SystemAccess &access )
+{
+  access.reads<ParticleEmitter>().writes<Particle, Locus, Entities>();
 }
 
 void ParticleSystem::update( EntityManagerRef es, EventManagerRef events, double dt )
 {
+  // entities destroyed earlier in this step are only dropped once queued destruction events are delivered
   for( auto entity : mEmitters )
   {
+    if( !entity.valid() ){ continue; }
     auto emitter = entity.component<ParticleEmitter>();
     auto loc = entity.component<Locus>();
     Entity e = es->create();
@@ -98,6 +109,7 @@ void ParticleSystem::update( EntityManagerRef es, EventManagerRef events, double
 
   for( auto entity : mParticles )
   {
+    if( !entity.valid() ){ continue; }
     // Perform verlet integration
     ParticleRef p = entity.component<Particle>();
     LocusRef l = entity.component<Locus>();
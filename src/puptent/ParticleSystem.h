@@ -70,15 +70,18 @@ namespace puptent
   struct ParticleSystem : public System<ParticleSystem>, Receiver<ParticleSystem>
   {
     void configure( EventManagerRef events ) override;
+    //! spawns particles from emitters and integrates their loci
+    void declare( SystemAccess &access ) override;
     void update( EntityManagerRef es, EventManagerRef events, double dt ) override;
     void receive( const ComponentAddedEvent<Particle> &event );
     void receive( const ComponentRemovedEvent<Particle> &event );
     void receive( const ComponentAddedEvent<ParticleEmitter> &event );
     void receive( const ComponentRemovedEvent<ParticleEmitter> &event );
-    void receive( const EntityDestroyedEvent &event );
+    void receive( span<const EntityDestroyedEvent> events );
   private:
     std::vector<Entity>       mParticles;
     std::vector<Entity>       mEmitters;
+    std::vector<Entity::Id>   mDestroyed;
     ci::Vec3f                 mGravity;
     bool                      mHandleEvents;
   };
@@ -0,0 +1,351 @@
+/*
+ * Copyright (c) 2013 David Wicks, sansumbrella.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "puptent/PathSystem.h"
+
+using namespace puptent;
+using namespace cinder;
+using namespace std;
+
+namespace
+{
+  //! left-hand normal of \a v
+  inline Vec2f perpendicular( const Vec2f &v ){ return Vec2f{ -v.y, v.x }; }
+  inline float cross( const Vec2f &a, const Vec2f &b ){ return a.x * b.y - a.y * b.x; }
+
+  //! Wang's formula: segments that keep a Bézier within tolerance of its chords
+  //! degree_term is n(n - 1) / 8 for a curve of degree n
+  size_t curveSegments( float degree_term, float second_difference, float tolerance )
+  {
+    float n = math<float>::ceil( math<float>::sqrt( degree_term * second_difference / tolerance ) );
+    return math<float>::clamp( n, 1.0f, 256.0f );
+  }
+
+  //! Appends single-colored vertices to a mesh
+  struct StripWriter
+  {
+    StripWriter( RenderMesh &mesh, const ColorA8u &color ):
+    vertices( mesh.vertices ),
+    color( color )
+    {}
+    void add( const Vec2f &position ){ vertices.emplace_back( Vertex{ position, color, Vec2f::zero() } ); }
+    void pair( const Vec2f &left, const Vec2f &right ){ add( left ); add( right ); }
+    //! a left, right pair with \a outer on \a side (1 for left, -1 for right)
+    void sided( float side, const Vec2f &outer, const Vec2f &inner )
+    {
+      if( side > 0.0f ){ pair( outer, inner ); }
+      else { pair( inner, outer ); }
+    }
+    decltype( RenderMesh::vertices ) &vertices;
+    ColorA8u                          color;
+  };
+}
+
+PathComponent::PathComponent( float width, PathJoin join, PathCap cap ):
+mWidth( width ),
+mJoin( join ),
+mCap( cap )
+{}
+
+void PathComponent::moveTo( const Vec2f &point )
+{
+  mPoints.assign( 1, point );
+  mVerbs.clear();
+  mDirty = true;
+}
+
+void PathComponent::lineTo( const Vec2f &point )
+{
+  if( mPoints.empty() ){ moveTo( point ); return; }
+  mPoints.push_back( point );
+  mVerbs.push_back( eLine );
+  mDirty = true;
+}
+
+void PathComponent::quadTo( const Vec2f &control, const Vec2f &point )
+{
+  if( mPoints.empty() ){ moveTo( control ); }
+  mPoints.push_back( control );
+  mPoints.push_back( point );
+  mVerbs.push_back( eQuad );
+  mDirty = true;
+}
+
+void PathComponent::curveTo( const Vec2f &control_a, const Vec2f &control_b, const Vec2f &point )
+{
+  if( mPoints.empty() ){ moveTo( control_a ); }
+  mPoints.push_back( control_a );
+  mPoints.push_back( control_b );
+  mPoints.push_back( point );
+  mVerbs.push_back( eCubic );
+  mDirty = true;
+}
+
+void PathComponent::setPoints( const vector<Vec2f> &points )
+{
+  mPoints = points;
+  mVerbs.assign( points.empty() ? 0 : points.size() - 1, eLine );
+  mDirty = true;
+}
+
+void PathComponent::clear()
+{
+  mPoints.clear();
+  mVerbs.clear();
+  mDirty = true;
+}
+
+void PathComponent::setControlPoint( size_t index, const Vec2f &point )
+{
+  mPoints.at( index ) = point;
+  mDirty = true;
+}
+
+void PathComponent::tessellate( RenderMesh &mesh )
+{
+  static thread_local vector<Vec2f> points;
+  flatten( points );
+  stroke( points, mesh );
+  mesh.changed();
+  mDirty = false;
+}
+
+void PathComponent::flatten( vector<Vec2f> &points ) const
+{
+  points.clear();
+  if( mPoints.empty() ){ return; }
+  // drop points that would make zero-length segments
+  auto add = [&points]( const Vec2f &p )
+  {
+    if( points.empty() || (p - points.back()).lengthSquared() > 1.0e-6f ){ points.push_back( p ); }
+  };
+  add( mPoints[0] );
+  size_t index = 1;
+  for( Verb verb : mVerbs )
+  {
+    const Vec2f &p0 = mPoints[index - 1];
+    switch( verb )
+    {
+      case eLine:
+        add( mPoints[index] );
+        index += 1;
+        break;
+      case eQuad:
+      {
+        const Vec2f &c = mPoints[index];
+        const Vec2f &p1 = mPoints[index + 1];
+        size_t n = curveSegments( 0.25f, (p0 - c * 2.0f + p1).length(), mTolerance );
+        for( size_t i = 1; i <= n; ++i )
+        {
+          float t = float( i ) / n;
+          float u = 1.0f - t;
+          add( p0 * (u * u) + c * (2.0f * u * t) + p1 * (t * t) );
+        }
+        index += 2;
+        break;
+      }
+      case eCubic:
+      {
+        const Vec2f &c0 = mPoints[index];
+        const Vec2f &c1 = mPoints[index + 1];
+        const Vec2f &p1 = mPoints[index + 2];
+        float second_difference = math<float>::max( (p0 - c0 * 2.0f + c1).length(), (c0 - c1 * 2.0f + p1).length() );
+        size_t n = curveSegments( 0.75f, second_difference, mTolerance );
+        for( size_t i = 1; i <= n; ++i )
+        {
+          float t = float( i ) / n;
+          float u = 1.0f - t;
+          add( p0 * (u * u * u) + c0 * (3.0f * u * u * t) + c1 * (3.0f * u * t * t) + p1 * (t * t * t) );
+        }
+        index += 3;
+        break;
+      }
+    }
+  }
+  if( mClosed && points.size() > 2 && (points.back() - points.front()).lengthSquared() <= 1.0e-6f )
+  { // the closing segment joins them anyway
+    points.pop_back();
+  }
+}
+
+void PathComponent::stroke( const vector<Vec2f> &points, RenderMesh &mesh ) const
+{
+  mesh.vertices.clear();
+  const size_t count = points.size();
+  if( count < 2 ){ return; }
+  const bool closed = mClosed && count > 2;
+  const size_t segments = closed ? count : count - 1;
+  const float w = mWidth * 0.5f;
+
+  static thread_local vector<Vec2f> directions;
+  static thread_local vector<float> lengths;
+  directions.resize( segments );
+  lengths.resize( segments );
+  for( size_t i = 0; i < segments; ++i )
+  {
+    Vec2f edge = points[(i + 1) % count] - points[i];
+    lengths[i] = edge.length();
+    directions[i] = edge / lengths[i];
+  }
+
+  StripWriter strip{ mesh, mColor };
+  // expand the corner at points[index] from segment in to segment out
+  auto join = [&]( size_t index, size_t in, size_t out )
+  {
+    const Vec2f &p = points[index];
+    const Vec2f &d0 = directions[in];
+    const Vec2f &d1 = directions[out];
+    Vec2f n0 = perpendicular( d0 );
+    Vec2f n1 = perpendicular( d1 );
+    float turn = cross( d0, d1 );
+    float along = d0.dot( d1 );
+    if( math<float>::abs( turn ) < 1.0e-4f && along > 0.0f )
+    { // straight on
+      strip.pair( p + n0 * w, p - n0 * w );
+      return;
+    }
+    // offset to where the edges on the left side meet; doesn't exist for a u-turn
+    bool has_miter = along > -0.9999f;
+    Vec2f miter = has_miter ? (n0 + n1) * (w / (1.0f + along)) : Vec2f::zero();
+    // gentle turns, like those along a flattened curve, get a miter whatever the join
+    // when it strays no further than tolerance from a round or bevel join
+    float miter_length = miter.length();
+    bool miter_tip = has_miter && (mJoin == eMiterJoin ? miter_length <= mMiterLimit * w : miter_length - w <= mTolerance);
+    // the inner corner is usable when it lies along both segments
+    bool inner_corner = has_miter && math<float>::abs( miter.dot( d0 ) ) <= lengths[in] && math<float>::abs( miter.dot( d1 ) ) <= lengths[out];
+    if( miter_tip && inner_corner )
+    {
+      strip.pair( p + miter, p - miter );
+      return;
+    }
+    // the outside of the turn: left on right turns, right on left turns
+    float side = turn > 0.0f ? -1.0f : 1.0f;
+    Vec2f outer0 = p + n0 * (w * side);
+    Vec2f outer1 = p + n1 * (w * side);
+    // fan the outside around the inner corner, or around the point itself when segments are too short
+    Vec2f pivot = inner_corner ? p - miter * side : p;
+    if( !inner_corner ){ strip.sided( side, outer0, p - n0 * (w * side) ); }
+    strip.sided( side, outer0, pivot );
+    if( miter_tip )
+    {
+      strip.sided( side, p + miter * side, pivot );
+    }
+    else if( mJoin == eRoundJoin )
+    {
+      Vec2f u0 = n0 * side;
+      Vec2f toward = n1 * side - u0 * along;
+      toward = toward.lengthSquared() > 1.0e-8f ? toward.normalized() : d0;
+      float angle = math<float>::acos( math<float>::clamp( along, -1.0f, 1.0f ) );
+      size_t steps = RenderMesh::circleSegments( w, angle, mTolerance );
+      for( size_t i = 1; i < steps; ++i )
+      {
+        float a = angle * i / steps;
+        strip.sided( side, p + (u0 * math<float>::cos( a ) + toward * math<float>::sin( a )) * w, pivot );
+      }
+    }
+    strip.sided( side, outer1, pivot );
+    if( !inner_corner ){ strip.sided( side, outer1, p - n1 * (w * side) ); }
+  };
+
+  if( closed )
+  {
+    join( 0, segments - 1, 0 );
+  }
+  else
+  { // start cap
+    const Vec2f &p = points.front();
+    const Vec2f &d = directions.front();
+    Vec2f n = perpendicular( d );
+    if( mCap == eSquareCap )
+    {
+      strip.pair( p + (n - d) * w, p - (n + d) * w );
+    }
+    else if( mCap == eRoundCap )
+    { // rim and center alternate around the back, from left to right
+      size_t steps = RenderMesh::circleSegments( w, M_PI, mTolerance );
+      for( size_t i = 0; i <= steps; ++i )
+      {
+        float a = M_PI * i / steps;
+        strip.add( p + (n * math<float>::cos( a ) - d * math<float>::sin( a )) * w );
+        if( i < steps ){ strip.add( p ); }
+      }
+    }
+    strip.pair( p + n * w, p - n * w );
+  }
+
+  const size_t last = closed ? count : count - 1;
+  for( size_t i = 1; i < last; ++i )
+  {
+    join( i, i - 1, i );
+  }
+
+  if( closed )
+  { // back to where the first corner started
+    Vertex left = mesh.vertices[0];
+    Vertex right = mesh.vertices[1];
+    mesh.vertices.push_back( left );
+    mesh.vertices.push_back( right );
+  }
+  else
+  { // end cap
+    const Vec2f &p = points.back();
+    const Vec2f &d = directions.back();
+    Vec2f n = perpendicular( d );
+    strip.pair( p + n * w, p - n * w );
+    if( mCap == eSquareCap )
+    {
+      strip.pair( p + (n + d) * w, p - (n - d) * w );
+    }
+    else if( mCap == eRoundCap )
+    { // around the front, from right to left
+      size_t steps = RenderMesh::circleSegments( w, M_PI, mTolerance );
+      for( size_t i = 1; i <= steps; ++i )
+      {
+        float a = M_PI * i / steps;
+        strip.add( p );
+        strip.add( p + (d * math<float>::sin( a ) - n * math<float>::cos( a )) * w );
+      }
+    }
+  }
+}
+
+void PathSystem::declare( SystemAccess &access )
+{
+  access.writes<PathComponent, RenderMesh>();
+}
+
+void PathSystem::update( EntityManagerRef es, EventManagerRef events, double dt )
+{ // only changed paths are tessellated again
+  for( auto entity : es->entities_with_components<PathComponent, RenderMesh>() )
+  {
+    auto path = entity.component<PathComponent>();
+    if( path->isDirty() )
+    {
+      path->tessellate( *entity.component<RenderMesh>() );
+    }
+  }
+}
@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2013 David Wicks, sansumbrella.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+#include "puptent/PupTent.h"
+#include "puptent/RenderMesh.h"
+
+namespace puptent
+{
+  //! How a path's stroke turns its corners
+  enum PathJoin
+  {
+    eMiterJoin,
+    eRoundJoin,
+    eBevelJoin,
+  };
+  //! How a path's stroke ends
+  enum PathCap
+  {
+    eButtCap,
+    eSquareCap,
+    eRoundCap,
+  };
+
+  /**
+   PathComponent:
+   A stroked path of lines and Bézier curves, drawn through the entity's
+   RenderMesh. Curves are flattened to within a tolerance in pixels, and
+   joins and caps are expanded into the mesh's triangle strip.
+   The tessellation is cached; PathSystem only rebuilds the mesh after the
+   path or its style changes, so unchanging paths cost next to nothing.
+   Build a path with moveTo(), lineTo(), quadTo() and curveTo(), or all at
+   once with setPoints(). Move control points with setControlPoint().
+   */
+  typedef std::shared_ptr<class PathComponent> PathComponentRef;
+  struct PathComponent : Component<PathComponent>
+  {
+    PathComponent( float width=4.0f, PathJoin join=eMiterJoin, PathCap cap=eButtCap );
+    //! start the path over at \a point
+    void              moveTo( const ci::Vec2f &point );
+    void              lineTo( const ci::Vec2f &point );
+    //! quadratic Bézier curve to \a point
+    void              quadTo( const ci::Vec2f &control, const ci::Vec2f &point );
+    //! cubic Bézier curve to \a point
+    void              curveTo( const ci::Vec2f &control_a, const ci::Vec2f &control_b, const ci::Vec2f &point );
+    //! replace the path with a polyline through \a points
+    void              setPoints( const std::vector<ci::Vec2f> &points );
+    //! join the end of the path back to its start
+    void              setClosed( bool closed=true ){ mClosed = closed; mDirty = true; }
+    void              clear();
+
+    //! every point passed to the building methods, in order
+    size_t            controlPointCount() const { return mPoints.size(); }
+    const ci::Vec2f&  getControlPoint( size_t index ) const { return mPoints.at( index ); }
+    void              setControlPoint( size_t index, const ci::Vec2f &point );
+
+    //! stroke width, edge to edge
+    void              setWidth( float width ){ mWidth = width; mDirty = true; }
+    void              setJoin( PathJoin join ){ mJoin = join; mDirty = true; }
+    void              setCap( PathCap cap ){ mCap = cap; mDirty = true; }
+    //! longest miter, in stroke widths, before a miter join falls back to a bevel
+    void              setMiterLimit( float limit ){ mMiterLimit = limit; mDirty = true; }
+    //! furthest, in pixels, that flattened curves and rounded joins may stray from the true shape
+    void              setTolerance( float tolerance ){ mTolerance = tolerance; mDirty = true; }
+    void              setColor( const ci::ColorA8u &color ){ mColor = color; mDirty = true; }
+    float             getWidth() const { return mWidth; }
+    PathJoin          getJoin() const { return mJoin; }
+    PathCap           getCap() const { return mCap; }
+    const ci::ColorA8u& getColor() const { return mColor; }
+    bool              isClosed() const { return mClosed; }
+
+    //! true when the path has changed since it was last tessellated
+    bool              isDirty() const { return mDirty; }
+    //! expand the stroke into \a mesh's vertices, in triangle_strip order
+    void              tessellate( RenderMesh &mesh );
+  private:
+    enum Verb
+    {
+      eLine,
+      eQuad,
+      eCubic
+    };
+    //! line and curve end points, in order, after the starting point
+    void              flatten( std::vector<ci::Vec2f> &points ) const;
+    void              stroke( const std::vector<ci::Vec2f> &points, RenderMesh &mesh ) const;
+
+    //! one verb per line or curve, using 1, 2 or 3 points after the first
+    std::vector<ci::Vec2f>  mPoints;
+    std::vector<Verb>       mVerbs;
+    float                   mWidth;
+    PathJoin                mJoin;
+    PathCap                 mCap;
+    float                   mMiterLimit = 4.0f;
+    float                   mTolerance = 0.25f;
+    ci::ColorA8u            mColor = ci::ColorA8u::white();
+    bool                    mClosed = false;
+    bool                    mDirty = true;
+  };
+
+  /**
+   PathSystem:
+   Tessellates changed paths into their entity's RenderMesh.
+   Give the entity a RenderData for the mesh to draw the path.
+   */
+  struct PathSystem : public System<PathSystem>
+  {
+    void declare( SystemAccess &access ) override;
+    void update( EntityManagerRef es, EventManagerRef events, double dt ) override;
+  };
+} // puptent::
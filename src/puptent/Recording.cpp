@@ -0,0 +1,198 @@
+/*
+ * Copyright (c) 2013 David Wicks, sansumbrella.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "puptent/Recording.h"
+#include "puptent/Locus.h"
+#include "puptent/RenderSystem.h"
+#include "cinder/Rand.h"
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+using namespace puptent;
+using namespace cinder;
+using namespace std;
+
+namespace
+{
+  const char *header = "puptent-recording 1";
+
+  // FNV-1a over raw bytes; floats are hashed by bit pattern
+  struct Hasher
+  {
+    uint64_t value = 14695981039346656037ULL;
+    template<typename T>
+    void add( const T &data )
+    {
+      const unsigned char *bytes = reinterpret_cast<const unsigned char*>( &data );
+      for( size_t i = 0; i < sizeof( T ); ++i )
+      {
+        value = ( value ^ bytes[i] ) * 1099511628211ULL;
+      }
+    }
+  };
+
+  void writeKeys( ostream &out, const vector<int> &keys )
+  {
+    out << ' ' << keys.size();
+    for( int key : keys )
+    {
+      out << ' ' << key;
+    }
+  }
+
+  void readKeys( istream &in, vector<int> &keys )
+  {
+    size_t count = 0;
+    in >> count;
+    keys.resize( count );
+    for( auto &key : keys )
+    {
+      in >> key;
+    }
+  }
+}
+
+Recording::Recording( const fs::path &path )
+{
+  ifstream in( path.string() );
+  string line;
+  if( !getline( in, line ) || line != header )
+  {
+    throw runtime_error( "Not a puptent recording: " + path.string() );
+  }
+  getline( in, mScenario );
+  while( getline( in, line ) )
+  {
+    if( line.empty() ){ continue; }
+    istringstream frame_in( line );
+    FrameRecord frame;
+    string dt;
+    frame_in >> dt >> frame.seed;
+    // hex floats keep dt exact; stream extraction of them is unreliable, strtod isn't
+    frame.dt = strtod( dt.c_str(), nullptr );
+    readKeys( frame_in, frame.keys_down );
+    readKeys( frame_in, frame.keys_up );
+    frame_in >> hex >> frame.hash;
+    if( !frame_in )
+    {
+      throw runtime_error( "Malformed frame in recording: " + line );
+    }
+    mFrames.push_back( frame );
+  }
+}
+
+void Recording::beginFrame( double dt )
+{ // any fixed sequence will do; it only has to be written down
+  mNextSeed = mNextSeed * 1664525u + 1013904223u;
+  FrameRecord frame;
+  frame.dt = dt;
+  frame.seed = mNextSeed;
+  mFrames.push_back( frame );
+  Rand::randSeed( frame.seed );
+}
+
+void Recording::endFrame( const vector<int> &keys_down, const vector<int> &keys_up, uint64_t hash )
+{
+  auto &frame = mFrames.back();
+  frame.keys_down = keys_down;
+  frame.keys_up = keys_up;
+  frame.hash = hash;
+}
+
+void Recording::save( const fs::path &path ) const
+{
+  ofstream out( path.string() );
+  out << header << '\n' << mScenario << '\n';
+  char dt[32];
+  for( const auto &frame : mFrames )
+  {
+    snprintf( dt, sizeof( dt ), "%a", frame.dt );
+    out << dt << ' ' << frame.seed;
+    writeKeys( out, frame.keys_down );
+    writeKeys( out, frame.keys_up );
+    out << ' ' << hex << frame.hash << dec << '\n';
+  }
+}
+
+uint64_t puptent::worldHash( EntityManagerRef entities )
+{
+  Hasher hasher;
+  for( auto entity : entities->entities_with_components<Locus>() )
+  {
+    hasher.add( entity.id().id() );
+    auto locus = entity.component<Locus>();
+    hasher.add( locus->position );
+    hasher.add( locus->rotation );
+    hasher.add( locus->scale );
+    auto mesh = entity.component<RenderMesh>();
+    if( mesh )
+    {
+      for( const auto &vertex : mesh->vertices )
+      {
+        hasher.add( vertex.position );
+        hasher.add( vertex.tex_coord );
+        hasher.add( vertex.color );
+      }
+    }
+    else if( auto trail = entity.component<RibbonTrail>() )
+    { // in draw order, as the equivalent RenderMesh would be
+      const auto &vertices = trail->vertices();
+      for( size_t i = 0; i < vertices.size(); ++i )
+      {
+        const auto &vertex = vertices[(trail->headVertex() + i) % vertices.size()];
+        hasher.add( vertex.position );
+        hasher.add( vertex.tex_coord );
+        hasher.add( vertex.color );
+      }
+    }
+    else if( auto data = entity.component<RenderData>() )
+    { // quad or shared geometry, as drawn
+      if( data->quad )
+      {
+        hasher.add( data->quad->size );
+        hasher.add( data->quad->registration_point );
+        hasher.add( data->quad->texture_bounds.getUpperLeft() );
+        hasher.add( data->quad->texture_bounds.getLowerRight() );
+        hasher.add( data->quad->color );
+      }
+      else if( data->geometry )
+      {
+        for( const auto &vertex : data->geometry->vertices )
+        {
+          hasher.add( vertex.position );
+          hasher.add( vertex.tex_coord );
+        }
+      }
+      hasher.add( data->color );
+      hasher.add( data->texture_bounds.getUpperLeft() );
+      hasher.add( data->texture_bounds.getLowerRight() );
+    }
+  }
+  return hasher.value;
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2013 David Wicks, sansumbrella.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+#include "puptent/PupTent.h"
+#include "cinder/Filesystem.h"
+
+namespace puptent
+{
+  /**
+   FrameRecord:
+   Everything from outside the simulation that went into one frame.
+   */
+  struct FrameRecord
+  {
+    //! time passed to SystemManager::update_frame
+    double            dt = 0.0;
+    //! Rand is reseeded with this before the frame runs
+    uint32_t          seed = 0;
+    //! key codes KeyboardInput applied this frame, in order
+    std::vector<int>  keys_down;
+    std::vector<int>  keys_up;
+    //! worldHash() after the frame ran; 0 if not known
+    uint64_t          hash = 0;
+  };
+
+  /**
+   Recording:
+   Per-frame dt, input and random seeds of a run, so it can be played back
+   exactly, eg. through the headless runner to compare builds.
+
+   To record, call beginFrame() with the frame's dt before updating;
+   it reseeds Rand. Then call endFrame() with the input and world after updating.
+   To replay, for each of frames(): reseed Rand with its seed, queue its keys
+   on a KeyboardInput, update with its dt, and compare worldHash() to its hash.
+
+   Saved as text, one frame per line, with dt written exactly.
+   */
+  class Recording
+  {
+  public:
+    Recording() = default;
+    //! load a recording written by save()
+    explicit Recording( const ci::fs::path &path );
+    //! the scenario or other description of the world the recording starts from
+    void                setScenario( const std::string &scenario ){ mScenario = scenario; }
+    const std::string&  getScenario() const { return mScenario; }
+    //! start recording a frame: pick a seed and seed Rand with it
+    void                beginFrame( double dt );
+    //! finish the frame begun last with its input and resulting world hash
+    void                endFrame( const std::vector<int> &keys_down, const std::vector<int> &keys_up, uint64_t hash );
+    const std::vector<FrameRecord>& frames() const { return mFrames; }
+    void                save( const ci::fs::path &path ) const;
+  private:
+    std::string               mScenario;
+    std::vector<FrameRecord>  mFrames;
+    uint32_t                  mNextSeed = 0x9e3779b9;
+  };
+
+  //! hash of every entity id, Locus and RenderMesh vertex (or shared RenderData geometry) in the world
+  //! equal hashes after the same frame mean a replay has not diverged
+  uint64_t worldHash( EntityManagerRef entities );
+} // puptent::
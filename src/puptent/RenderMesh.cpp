@@ -27,43 +27,126 @@
 
 #include "puptent/RenderMesh.h"
 #include "puptent/TextureAtlas.h"
+#include <array>
+#include <atomic>
+#include <cstring>
 
 using namespace puptent;
 using namespace cinder;
 
+namespace
+{
+  // source of mesh and trail revisions; meshes may be edited by systems running in parallel
+  std::atomic<uint64_t> sRevisions( 0 );
+
+  //! smallest rect containing \a member of every vertex
+  template<typename Container>
+  Rectf vertexBounds( const Container &vertices, Vec2f Vertex::*member )
+  {
+    if( vertices.empty() ){ return Rectf{ 0.0f, 0.0f, 0.0f, 0.0f }; }
+    Rectf bounds{ vertices.front().*member, vertices.front().*member };
+    for( const auto &vert : vertices )
+    {
+      bounds.include( vert.*member );
+    }
+    return bounds;
+  }
+
+  //! Points on the unit circle from angle 0 to arc, segments + 1 of them
+  struct UnitArc
+  {
+    size_t            segments = 0;
+    float             arc = 0.0f;
+    std::vector<Vec2f> points;
+  };
+
+  //! Looks up a unit arc in a small per-thread cache; a miss rebuilds one slot,
+  //! so animated arcs can't grow the cache without bound.
+  const std::vector<Vec2f>& unitArc( size_t segments, float arc )
+  {
+    static thread_local std::array<UnitArc, 32> cache;
+    uint32_t arc_bits;
+    std::memcpy( &arc_bits, &arc, sizeof( arc_bits ) );
+    UnitArc &entry = cache[( segments * 31 + arc_bits ) % cache.size()];
+    if( entry.segments != segments || entry.arc != arc || entry.points.empty() )
+    {
+      entry.segments = segments;
+      entry.arc = arc;
+      entry.points.resize( segments + 1 );
+      for( size_t i = 0; i <= segments; ++i )
+      {
+        float t = arc * i / segments;
+        entry.points[i] = Vec2f{ math<float>::cos( t ), math<float>::sin( t ) };
+      }
+    }
+    return entry.points;
+  }
+}
+
+const Rectf& RenderMesh::getBounds() const
+{
+  if( mBoundsDirty )
+  {
+    mBounds = vertexBounds( vertices, &Vertex::position );
+    mBoundsDirty = false;
+  }
+  return mBounds;
+}
+
+void RenderMesh::changed()
+{
+  mBoundsDirty = true;
+  mRevision = ++sRevisions;
+}
+
 void RenderMesh::transform(const ci::MatrixAffine2f &mat)
 {
   for( Vertex &v : vertices )
   {
     v.position = mat.transformVec( v.position );
   }
+  changed();
+}
+
+size_t RenderMesh::circleSegments( float radius, float arc_radians, float tolerance )
+{
+  radius = math<float>::abs( radius );
+  if( radius <= tolerance ){ return 3; }
+  // each segment may span the angle whose chord sits tolerance inside the arc
+  float step = 2 * math<float>::acos( 1 - tolerance / radius );
+  size_t segments = math<float>::ceil( math<float>::abs( arc_radians ) / step );
+  return std::max<size_t>( segments, 3 );
 }
 
 void RenderMesh::setAsCircle(const ci::Vec2f &radius, float start_radians, float end_radians, size_t segments )
 {
-  if( segments < 2 ) { // based off of cinder, though we're less generous with the vertices
-    segments = math<float>::floor( math<float>::max( radius.x, radius.y ) * abs(end_radians - start_radians) / 3 );
+  if( segments < 2 ) {
+    segments = circleSegments( math<float>::max( radius.x, radius.y ), end_radians - start_radians );
   }
   if( segments < 3 ){
     segments = 3;
   }
-  if( vertices.size() != segments * 5 )
+  // rim and center alternate: rim0, center, rim1, center, ..., rim(n)
+  // every other triangle is degenerate, leaving the wedges (rim i, center, rim i+1)
+  const size_t count = segments * 2 + 1;
+  if( vertices.size() != count )
   {
-    vertices.assign( segments * 5, Vertex{} );
+    vertices.assign( count, Vertex{} );
   }
-  Vec2f a{ 0.0f, 0.0f };
-  for( int i = 0; i < segments; ++i )
+  const std::vector<Vec2f> &unit = unitArc( segments, end_radians - start_radians );
+  // rotate the table to start_radians and scale it out to the radius
+  const float cs = math<float>::cos( start_radians ), sn = math<float>::sin( start_radians );
+  const Vec2f x_axis{ cs * radius.x, sn * radius.y };
+  const Vec2f y_axis{ -sn * radius.x, cs * radius.y };
+  Vertex *v = vertices.data();
+  const Vec2f *u = unit.data();
+  for( size_t i = 0; i < segments; ++i )
   {
-    float t1 = lmap<float>( i, 0, segments, start_radians, end_radians );
-    float t2 = lmap<float>( i + 1, 0, segments, start_radians, end_radians );
-    Vec2f b = Vec2f{ math<float>::cos( t1 ), math<float>::sin( t1 ) } * radius;
-    Vec2f c = Vec2f{ math<float>::cos( t2 ), math<float>::sin( t2 ) } * radius;
-    vertices.at(i * 5 + 0).position = a;
-    vertices.at(i * 5 + 1).position = b;
-    vertices.at(i * 5 + 2).position = c;
-    vertices.at(i * 5 + 3).position = c;
-    vertices.at(i * 5 + 4).position = a;
+    v[i * 2].position = Vec2f{ x_axis.x * u[i].x + y_axis.x * u[i].y, x_axis.y * u[i].x + y_axis.y * u[i].y };
+    v[i * 2 + 1].position = Vec2f{ 0.0f, 0.0f };
   }
+  v[count - 1].position = Vec2f{ x_axis.x * u[segments].x + y_axis.x * u[segments].y, x_axis.y * u[segments].x + y_axis.y * u[segments].y };
+  changed();
 }
 
 void RenderMesh::setAsBox( const Rectf &bounds )
@@ -73,6 +156,7 @@ void RenderMesh::setAsBox( const Rectf &bounds )
   vertices[1].position = bounds.getUpperLeft();
   vertices[2].position = bounds.getLowerRight();
   vertices[3].position = bounds.getLowerLeft();
+  changed();
 }
 
 void RenderMesh::setBoxTextureCoords( const SpriteData &sprite_data )
@@ -81,6 +165,7 @@ void RenderMesh::setBoxTextureCoords( const SpriteData &sprite_data )
   vertices[1].tex_coord = sprite_data.texture_bounds.getUpperLeft();
   vertices[2].tex_coord = sprite_data.texture_bounds.getLowerRight();
   vertices[3].tex_coord = sprite_data.texture_bounds.getLowerLeft();
+  changed();
 }
 
 void RenderMesh::matchTexture(const SpriteData &sprite_data)
@@ -96,6 +181,14 @@ void RenderMesh::matchTexture(const SpriteData &sprite_data)
   vertices[1].tex_coord = sprite_data.texture_bounds.getUpperLeft();
   vertices[2].tex_coord = sprite_data.texture_bounds.getLowerRight();
   vertices[3].tex_coord = sprite_data.texture_bounds.getLowerLeft();
+  changed();
+}
+
+void SpriteQuad::matchTexture( const SpriteData &sprite_data )
+{
+  size = sprite_data.size;
+  registration_point = sprite_data.registration_point;
+  texture_bounds = sprite_data.texture_bounds;
 }
 
 void RenderMesh::setAsTriangle(const ci::Vec2f &a, const ci::Vec2f &b, const ci::Vec2f &c)
@@ -104,6 +197,7 @@ void RenderMesh::setAsTriangle(const ci::Vec2f &a, const ci::Vec2f &b, const ci:
   vertices[0].position = a;
   vertices[1].position = b;
   vertices[2].position = c;
+  changed();
 }
 
 void RenderMesh::setAsLine( const Vec2f &begin, const Vec2f &end, float width )
@@ -119,6 +213,7 @@ void RenderMesh::setAsLine( const Vec2f &begin, const Vec2f &end, float width )
   vertices.at(1).position = begin + N;
   vertices.at(2).position = end + S;
   vertices.at(3).position = end + N;
+  changed();
 }
 
 void RenderMesh::setAsCappedLine( const ci::Vec2f &begin, const ci::Vec2f &end, float width )
@@ -142,6 +237,7 @@ void RenderMesh::setAsCappedLine( const ci::Vec2f &begin, const ci::Vec2f &end,
   vertices.at(5).position = end + N;
   vertices.at(6).position = end + SE;
   vertices.at(7).position = end + NE;
+  changed();
 }
 
 void RenderMesh::setColor( const ColorA8u &color )
@@ -150,4 +246,84 @@ void RenderMesh::setColor( const ColorA8u &color )
   {
     vert.color = color;
   }
+  changed();
+}
+
+MeshGeometry::MeshGeometry( std::vector<Vertex> vertices ):
+vertices( std::move( vertices ) ),
+texture_bounds( vertexBounds( this->vertices, &Vertex::tex_coord ) ),
+bounds( vertexBounds( this->vertices, &Vertex::position ) )
+{}
+
+MeshGeometryRef MeshGeometry::create( std::vector<Vertex> vertices )
+{
+  return MeshGeometryRef{ new MeshGeometry{ std::move( vertices ) } };
+}
+
+MeshGeometryRef MeshGeometry::create( const RenderMesh &mesh )
+{
+  return create( std::vector<Vertex>( mesh.vertices.begin(), mesh.vertices.end() ) );
+}
+
+MeshGeometryRef MeshGeometry::create( const SpriteData &sprite_data )
+{
+  RenderMesh mesh{ 4 };
+  mesh.matchTexture( sprite_data );
+  return create( mesh );
+}
+
+RibbonTrail::RibbonTrail( size_t length, const Vec2f &start, float width, const ColorA8u &color ):
+width( width ),
+mPoints( std::max<size_t>( length, 2 ), start ),
+mVertices( mPoints.size() * 2, Vertex{ start, color, Vec2f::zero() } ),
+mRevision( ++sRevisions )
+{}
+
+void RibbonTrail::push( const Vec2f &point )
+{
+  const size_t n = mPoints.size();
+  // the oldest point's slot becomes the head
+  mHead = (mHead + n - 1) % n;
+  mPoints[mHead] = point;
+  const size_t second = (mHead + 1) % n;
+  const size_t tail = (mHead + n - 1) % n;
+  expand( mHead, mPoints[second] - point );
+  if( n > 2 )
+  { // the old head now has neighbors on both sides
+    const Vec2f &a = point;
+    const Vec2f &b = mPoints[second];
+    const Vec2f &c = mPoints[(second + 1) % n];
+    expand( second, ((b - a).normalized() + (c - b).normalized()) * 0.5f );
+  }
+  // the new tail has lost its older neighbor
+  expand( tail, mPoints[tail] - mPoints[(tail + n - 1) % n] );
+  mBoundsDirty = true;
+  mRevision = ++sRevisions;
+}
+
+const Rectf& RibbonTrail::getBounds() const
+{
+  if( mBoundsDirty )
+  {
+    mBounds = vertexBounds( mVertices, &Vertex::position );
+    mBoundsDirty = false;
+  }
+  return mBounds;
+}
+
+void RibbonTrail::expand( size_t index, const Vec2f &edge )
+{
+  Vec2f tangent = Vec2f( -edge.y, edge.x );
+  Vec2f north = tangent.normalized() * width;
+  mVertices[index * 2].position = mPoints[index] + north;
+  mVertices[index * 2 + 1].position = mPoints[index] - north;
+}
+
+void RibbonTrail::setColor( const ColorA8u &color )
+{
+  for( Vertex &v : mVertices )
+  {
+    v.color = color;
+  }
+  mRevision = ++sRevisions;
 }
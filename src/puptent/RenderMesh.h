@@ -27,6 +27,13 @@
 
 #pragma once
 #include "puptent/PupTent.h"
+#include "puptent/SmallVector.h"
+
+// Vertices a RenderMesh holds without allocating; enough for a sprite, a
+// triangle or a capped line. Larger meshes, like circles and ribbons, go to the heap.
+#ifndef PUPTENT_INLINE_VERTICES
+#define PUPTENT_INLINE_VERTICES 8
+#endif
 
 namespace puptent
 {
@@ -63,12 +70,18 @@ namespace puptent
     RenderMesh( int vertex_count=3 )
     {
       vertices.assign( vertex_count, Vertex{} );
+      changed();
     }
-    //! vertices in triangle_strip order
-    std::vector<Vertex> vertices;
+    //! vertices in triangle_strip order; the first PUPTENT_INLINE_VERTICES are stored inline
+    //! call changed() after editing them yourself
+    SmallVector<Vertex, PUPTENT_INLINE_VERTICES> vertices;
     //! Convenience method for making circular shapes
-    //! If you aren't dynamically changing the circle, consider using a Sprite
+    //! Emits 2 vertices per segment from cached unit-circle tables, so rebuilding every frame is cheap.
+    //! With no \a segments, picks circleSegments() for the radius as drawn at scale 1;
+    //! pass circleSegments( radius * scale, arc ) for circles drawn larger or smaller.
     void setAsCircle( const ci::Vec2f &radius, float start_radians=0, float end_radians=M_PI * 2, size_t segments=0 );
+    //! Fewest segments that keep an arc of \a radius pixels on screen within \a tolerance pixels of the true curve
+    static size_t circleSegments( float radius, float arc_radians=M_PI * 2, float tolerance=0.25f );
     //! Set the mesh bounds to a box shape
     void setAsBox( const ci::Rectf &bounds );
     //! Set the texture coords to those specified by the sprite data
@@ -88,9 +101,107 @@ namespace puptent
     void setAsTriangle( const ci::Vec2f &a, const ci::Vec2f &b, const ci::Vec2f &c );
     //! Set the color of all vertices in one go
     void setColor( const ci::ColorA8u &color );
+    //! smallest rect containing every vertex position
+    //! recomputed when next asked for after the methods above or changed()
+    const ci::Rectf& getBounds() const;
+    //! call after editing vertices directly, so bounds and RenderSystem see the edit
+    void changed();
+    //! changes whenever the vertices do; unique among all meshes and trails
+    uint64_t revision() const { return mRevision; }
+  private:
+    mutable ci::Rectf mBounds;
+    mutable bool      mBoundsDirty = true;
+    uint64_t          mRevision = 0;
+  };
+
+  /**
+   SpriteQuad:
+   A textured rectangle, like a RenderMesh after matchTexture(), kept as its
+   size, registration point, texture bounds and color instead of as four
+   vertices. RenderSystem expands it straight into the vertex batch.
+   Draw one by giving it to an entity's RenderData; SpriteAnimationSystem
+   keeps it showing the current frame.
+  */
+  typedef std::shared_ptr<class SpriteQuad> SpriteQuadRef;
+  struct SpriteQuad : Component<SpriteQuad>
+  {
+    SpriteQuad() = default;
+    explicit SpriteQuad( const SpriteData &sprite_data ) { matchTexture( sprite_data ); }
+    //! take the sprite's size, registration point and texture bounds
+    void          matchTexture( const SpriteData &sprite_data );
+    ci::Vec2f     size = ci::Vec2f::zero();
+    //! offset from the quad's upper-left corner to its origin
+    ci::Vec2f     registration_point = ci::Vec2f::zero();
+    ci::Rectf     texture_bounds = ci::Rectf( 0.0f, 0.0f, 0.0f, 0.0f );
+    ci::ColorA8u  color = ci::ColorA8u::white();
+  };
+
+  /**
+   MeshGeometry:
+   Immutable vertices, in triangle_strip order, that any number of entities
+   can share. Instead of owning a RenderMesh, an entity's RenderData points
+   to the geometry and supplies its own color and texture bounds.
+   Use for many copies of a shape, like the frames of an animated sprite.
+  */
+  typedef std::shared_ptr<const class MeshGeometry> MeshGeometryRef;
+  struct MeshGeometry
+  {
+    explicit MeshGeometry( std::vector<Vertex> vertices );
+    //! share a copy of \a vertices
+    static MeshGeometryRef create( std::vector<Vertex> vertices );
+    //! share a copy of \a mesh's current vertices
+    static MeshGeometryRef create( const RenderMesh &mesh );
+    //! a box of the sprite's size with the sprite's texture coordinates, as RenderMesh::matchTexture
+    static MeshGeometryRef create( const SpriteData &sprite_data );
+    const std::vector<Vertex>   vertices;
+    //! smallest rect containing every vertex's tex_coord
+    const ci::Rectf             texture_bounds;
+    //! smallest rect containing every vertex's position
+    const ci::Rectf             bounds;
   };
 
 
+  /**
+   RibbonTrail:
+   A ribbon that follows a moving point, like a ship's wake.
+   Keeps a fixed number of points in a ring. push() adds a point at the head
+   and drops the oldest, recomputing only the vertices at either end, so a
+   trail costs the same to update however long it is.
+   Expands like setAsRibbon() over the points, newest first.
+   Draw one by giving it to an entity's RenderData.
+  */
+  typedef std::shared_ptr<class RibbonTrail> RibbonTrailRef;
+  struct RibbonTrail : Component<RibbonTrail>
+  {
+    //! a trail of \a length points (at least 2), all at \a start
+    RibbonTrail( size_t length, const ci::Vec2f &start, float width, const ci::ColorA8u &color=ci::ColorA8u::white() );
+    //! add \a point at the head of the trail, dropping the oldest point
+    void          push( const ci::Vec2f &point );
+    //! set the color of all vertices in one go
+    void          setColor( const ci::ColorA8u &color );
+    //! number of points
+    size_t        size() const { return mPoints.size(); }
+    //! vertices in ring order; the triangle strip runs from headVertex() to the end, then wraps to the start
+    const std::vector<Vertex>& vertices() const { return mVertices; }
+    size_t        headVertex() const { return mHead * 2; }
+    //! smallest rect containing every vertex position; rescanned when next asked for after a push()
+    const ci::Rectf& getBounds() const;
+    //! changes with every push() or setColor(); unique among all meshes and trails
+    uint64_t      revision() const { return mRevision; }
+    //! half-width of the ribbon; changes apply to points pushed afterward
+    float         width;
+  private:
+    //! set the pair of vertices at \a index across \a edge
+    void          expand( size_t index, const ci::Vec2f &edge );
+    //! ring index of the newest point; older points follow it, wrapping around
+    size_t                  mHead = 0;
+    std::vector<ci::Vec2f>  mPoints;
+    std::vector<Vertex>     mVertices;
+    mutable ci::Rectf       mBounds;
+    mutable bool            mBoundsDirty = true;
+    uint64_t                mRevision;
+  };
+
   template<typename T>
   void RenderMesh::setAsRibbon( const T &skeleton, float width, bool closed )
   {
@@ -126,5 +237,6 @@ namespace puptent
     size_t end = skeleton.size() - 1;
     vertices.at( end * 2 ).position = c + north;
     vertices.at( end * 2 + 1 ).position = c - north;
+    changed();
   }
 } // puptent::
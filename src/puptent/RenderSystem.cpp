@@ -27,45 +27,109 @@
 
 #include "puptent/RenderSystem.h"
 #include "pockets/CollectionUtilities.hpp"
+#ifndef PUPTENT_HEADLESS
 #include "cinder/gl/Texture.h"
+#endif
+#include <cassert>
+#include <thread>
 
 using namespace cinder;
 using namespace puptent;
 using namespace std;
 
+Rectf RenderData::localBounds() const
+{
+  if( quad ){ return Rectf{ -quad->registration_point, quad->size - quad->registration_point }; }
+  if( mesh ){ return mesh->getBounds(); }
+  if( trail ){ return trail->getBounds(); }
+  if( geometry ){ return geometry->bounds; }
+  return Rectf{ 0.0f, 0.0f, 0.0f, 0.0f };
+}
+
+const Rectf& RenderData::worldBounds() const
+{
+  return worldBounds( locus->revision(), locus->toMatrix() );
+}
+
+const Rectf& RenderData::worldBounds( float alpha ) const
+{
+  return worldBounds( locus->revision( alpha ), locus->toMatrix( alpha ) );
+}
+
+const Rectf& RenderData::worldBounds( uint64_t locus_revision, const MatrixAffine2f &transform ) const
+{
+  Rectf local = localBounds();
+  if( locus_revision != mWorldBoundsRevision
+     || local.x1 != mWorldBoundsLocal.x1 || local.y1 != mWorldBoundsLocal.y1
+     || local.x2 != mWorldBoundsLocal.x2 || local.y2 != mWorldBoundsLocal.y2 )
+  { // bound the transformed corners
+    Vec2f corner = transform.transformPoint( local.getUpperLeft() );
+    mWorldBounds = Rectf{ corner, corner };
+    mWorldBounds.include( transform.transformPoint( local.getUpperRight() ) );
+    mWorldBounds.include( transform.transformPoint( local.getLowerRight() ) );
+    mWorldBounds.include( transform.transformPoint( local.getLowerLeft() ) );
+    mWorldBoundsLocal = local;
+    mWorldBoundsRevision = locus_revision;
+  }
+  return mWorldBounds;
+}
+
 void RenderSystem::configure( EventManagerRef event_manager )
 {
-  event_manager->subscribe<EntityDestroyedEvent>( *this );
-  event_manager->subscribe<ComponentAddedEvent<RenderData>>( *this );
+  // only hear about entities that we draw
+  event_manager->subscribe_batch<EntityDestroyedEvent>( *this, EventFilter::components<RenderData>() );
+  event_manager->subscribe_batch<ComponentAddedEvent<RenderData>>( *this );
   event_manager->subscribe<ComponentRemovedEvent<RenderData>>( *this );
+  event_manager->subscribe<FixedStepEvent>( *this );
 }
 
-void RenderSystem::receive(const ComponentAddedEvent<puptent::RenderData> &event)
+void RenderSystem::declare( SystemAccess &access )
 {
-  auto data = event.component;
-  const RenderPass pass = data->pass;
-  if( pass == eNormalPass )
-  { // put element in correct sorted position
-    int target_layer = data->render_layer;
-    if( mGeometry[pass].empty() )
+  // reading a Locus' transform, or any bounds when culling, updates their caches
+  access.reads<SpriteQuad>().writes<RenderData, RenderMesh, RibbonTrail, Locus>();
+}
+
+void RenderSystem::receive( const FixedStepEvent &event )
+{
+  mInterpolation = event.alpha;
+}
+
+void RenderSystem::receive( span<const ComponentAddedEvent<RenderData>> events )
+{
+  auto &normal = mGeometry[eNormalPass];
+  mAdded.clear();
+  for( const auto &event : events )
+  {
+    auto data = event.component;
+    mEntityData[event.entity.id().id()] = data;
+    mUnfiled.push_back( data.get() );
+    mLayoutDirty[data->pass] = true;
+    if( data->pass == eNormalPass )
     {
-      mGeometry[pass].push_back( event.component );
+      mAdded.push_back( data );
     }
     else
-    {
-      auto iter = mGeometry[pass].begin();
-      while( iter != mGeometry[pass].end() && (**iter).render_layer < target_layer )
-      { // place the component in the first position on its layer
-        ++iter;
-      }
-      mGeometry[pass].insert( iter, data );
+    { // just place element at end of list
+      // for add and multiply, order doesn't matter
+      mGeometry[data->pass].push_back( data );
     }
   }
-  else
-  { // just place element at end of list
-    // for add and multiply, order doesn't matter
-    mGeometry[pass].push_back( event.component );
+  if( mAdded.size() == 1 )
+  { // place the component in the first position on its layer
+    normal.insert( lower_bound( normal.begin(), normal.end(), mAdded.front(), &RenderSystem::layerSort ), mAdded.front() );
+  }
+  else if( mAdded.size() > 1 )
+  { // same order as adding one at a time: each goes ahead of those already on its layer
+    reverse( mAdded.begin(), mAdded.end() );
+    stable_sort( mAdded.begin(), mAdded.end(), &RenderSystem::layerSort );
+    mMerged.clear();
+    mMerged.reserve( normal.size() + mAdded.size() );
+    merge( mAdded.begin(), mAdded.end(), normal.begin(), normal.end(), back_inserter( mMerged ), &RenderSystem::layerSort );
+    normal.swap( mMerged );
+    mMerged.clear();
   }
+  mAdded.clear();
+  mOrderDirty = true;
 }
 
 void RenderSystem::checkOrdering() const
@@ -88,45 +152,532 @@ void RenderSystem::checkOrdering() const
 void RenderSystem::receive(const ComponentRemovedEvent<puptent::RenderData> &event)
 {
   auto data = event.component;
+  mEntityData.erase( event.entity.id().id() );
   vector_remove( &mGeometry[data->pass], data );
+  vector_remove( &mUnfiled, data.get() );
+  vector_remove( &mMoving, data.get() );
+  if( find( mStationary.begin(), mStationary.end(), data.get() ) != mStationary.end() )
+  {
+    vector_remove( &mStationary, data.get() );
+    mGridDirty = true;
+  }
+  mOrderDirty = true;
+  mLayoutDirty[data->pass] = true;
 }
 
-void RenderSystem::receive(const EntityDestroyedEvent &event)
-{
-  auto entity = event.entity;
-  auto render_data = entity.component<RenderData>();
-  if( render_data )
-  { // remove render component from our list
-    vector_remove( &mGeometry[render_data->pass], render_data );
+void RenderSystem::receive( span<const EntityDestroyedEvent> events )
+{ // collect the render data of every destroyed entity
+  mDestroyed.clear();
+  for( const auto &event : events )
+  {
+    auto iter = mEntityData.find( event.entity.id().id() );
+    if( iter != mEntityData.end() )
+    {
+      mDestroyed.push_back( iter->second.get() );
+      mEntityData.erase( iter );
+    }
   }
+  if( mDestroyed.empty() ){ return; }
+  // then remove them from each pass in a single sweep
+  std::sort( mDestroyed.begin(), mDestroyed.end() );
+  for( auto &geometry : mGeometry )
+  {
+    geometry.erase( remove_if( geometry.begin(), geometry.end(), [this]( const RenderDataRef &data ) {
+      return binary_search( mDestroyed.begin(), mDestroyed.end(), data.get() );
+    } ), geometry.end() );
+  }
+  auto destroyed = [this]( const RenderData *data ) {
+    return binary_search( mDestroyed.begin(), mDestroyed.end(), data );
+  };
+  mUnfiled.erase( remove_if( mUnfiled.begin(), mUnfiled.end(), destroyed ), mUnfiled.end() );
+  mMoving.erase( remove_if( mMoving.begin(), mMoving.end(), destroyed ), mMoving.end() );
+  auto stationary_end = remove_if( mStationary.begin(), mStationary.end(), destroyed );
+  if( stationary_end != mStationary.end() )
+  {
+    mStationary.erase( stationary_end, mStationary.end() );
+    mGridDirty = true;
+  }
+  mOrderDirty = true;
+  mLayoutDirty.fill( true );
+}
+
+void RenderSystem::setWorkerThreads( size_t count )
+{
+  mPool.reset( count ? new TaskPool( count ) : nullptr );
 }
 
 void RenderSystem::update( EntityManagerRef es, EventManagerRef events, double dt )
 { // assemble vertices for each pass
   const array<RenderPass, 3> passes = { eNormalPass, eAdditivePass, eMultiplyPass };
-  for( const auto &pass : passes )
+  // nothing moves while we read, so shared parents are only checked once
+  // and, once checked, loci can be read from any thread
+  Locus::ReadScope scope;
+  fileAdded();
+  mJobs.clear();
+  size_t total = mGeometry[eNormalPass].size() + mGeometry[eAdditivePass].size() + mGeometry[eMultiplyPass].size();
+  if( !mCulling )
   {
+    for( const auto &pass : passes )
+    {
+      assembleAll( pass );
+    }
+    runJobs();
+    mReassemble = false;
+    mDrawnCount = total;
+    mCulledCount = 0;
+    return;
+  }
+
+  cull();
+  mDrawnCount = 0;
+  for( const auto &pass : passes )
+  { // visible render data, in the order we would draw everything
+    auto &visible = mVisible[pass];
+    std::sort( visible.begin(), visible.end(), []( RenderData *lhs, RenderData *rhs ) {
+      return lhs->mDrawOrder < rhs->mDrawOrder;
+    } );
+    // place each one after those before it, bridged to those that draw something
+    mCounts.resize( visible.size() );
+    size_t first = visible.size();
+    size_t last = 0;
+    size_t size = 0;
+    for( size_t i = 0; i < visible.size(); ++i )
+    {
+      mCounts[i] = vertexCount( *visible[i] );
+      if( mCounts[i] > 0 )
+      {
+        first = std::min( first, i );
+        last = i;
+        size += mCounts[i] + 2;
+      }
+    }
     auto &v = mVertices[pass];
-    v.clear();
-    for( const auto &pair : mGeometry[pass] )
-    {
-      auto mesh = pair->mesh;
-      auto loc = pair->locus;
-      auto mat = loc->toMatrix();
-      if( !v.empty() )
-      { // create degenerate triangle between previous and current shape
-        v.emplace_back( v.back() );
-        auto vert = mesh->vertices.front();
-        v.emplace_back( Vertex{ mat.transformPoint( vert.position ), vert.color, vert.tex_coord } );
+    v.resize( size > 0 ? size - 2 : 0 );
+    size_t offset = 0;
+    for( size_t i = 0; i < visible.size(); ++i )
+    {
+      if( mCounts[i] == 0 ){ continue; }
+      const bool before = i > first;
+      const bool after = i < last;
+      queue( Job{ visible[i], nullptr, &v[offset], 0, before, after } );
+      offset += mCounts[i] + before + after;
+    }
+    mDrawnCount += visible.size();
+  }
+  runJobs();
+  mCulledCount = total - mDrawnCount;
+  // every range has been written over
+  mReassemble = true;
+}
+
+void RenderSystem::assembleAll( RenderPass pass )
+{
+  const auto &geometry = mGeometry[pass];
+  auto &v = mVertices[pass];
+  if( !mLayoutDirty[pass] && !mReassemble )
+  { // transform only what changed, in place; a range can only change size when what it draws changes
+    const size_t jobs = mJobs.size();
+    bool resized = false;
+    for( const auto &data : geometry )
+    {
+      const auto &assembled = data->mAssembled;
+      if( data->stationary )
+      { // left as laid out; a culling update would show any change, so debug builds check the promise
+#ifdef DEBUG
+        const bool changed = checkChanged( *data );
+        assert( !changed && "stationary RenderData changed; clear stationary before changing it" );
+#endif
+        continue;
+      }
+      if( !checkChanged( *data ) ){ continue; }
+      const size_t count = vertexCount( *data );
+      if( (count > 0 ? count + assembled.bridge_before + assembled.bridge_after : 0) != assembled.size )
+      { // lay out again below, once everything is checked
+        resized = true;
+        continue;
+      }
+      if( count > 0 )
+      {
+        queue( Job{ data.get(), nullptr, &v[assembled.offset], 0, assembled.bridge_before, assembled.bridge_after } );
+      }
+    }
+    if( !resized ){ return; }
+    // what changed and is still queued is transformed into its new range instead
+    for( size_t i = jobs; i < mJobs.size(); ++i )
+    {
+      mJobs[i].data->mAssembled.size = 0;
+    }
+    mJobs.resize( jobs );
+  }
+
+  // lay every range out again, copying those that didn't change from where they were
+  // render data that draws nothing is skipped over when bridging
+  mCounts.resize( geometry.size() );
+  size_t first = geometry.size();
+  size_t last = 0;
+  size_t total = 0;
+  for( size_t i = 0; i < geometry.size(); ++i )
+  {
+    mCounts[i] = vertexCount( *geometry[i] );
+    if( mCounts[i] > 0 )
+    {
+      first = std::min( first, i );
+      last = i;
+      total += mCounts[i] + 2;
+    }
+  }
+  if( total > 0 )
+  { // no bridges before the first or after the last
+    total -= 2;
+  }
+  // the previous vertices stay in mLaidOut until the copies are made
+  auto &laid_out = mLaidOut[pass];
+  laid_out.resize( total );
+  v.swap( laid_out );
+  size_t offset = 0;
+  for( size_t i = 0; i < geometry.size(); ++i )
+  {
+    auto &data = *geometry[i];
+    auto &assembled = data.mAssembled;
+    const size_t count = mCounts[i];
+    const bool before = count > 0 && i > first;
+    const bool after = count > 0 && i < last;
+    const size_t size = count + before + after;
+    const bool changed = checkChanged( data );
+    if( size > 0 )
+    {
+      if( !changed && !mReassemble && size == assembled.size
+         && before == assembled.bridge_before && after == assembled.bridge_after )
+      {
+        queue( Job{ nullptr, &laid_out[assembled.offset], &v[offset], size, before, after } );
+      }
+      else
+      {
+        queue( Job{ &data, nullptr, &v[offset], 0, before, after } );
+      }
+    }
+    assembled.offset = offset;
+    assembled.size = size;
+    assembled.bridge_before = before;
+    assembled.bridge_after = after;
+    offset += size;
+  }
+  mLayoutDirty[pass] = false;
+}
+
+void RenderSystem::runJob( const Job &job ) const
+{
+  if( job.data )
+  {
+    assemble( *job.data, job.out, job.bridge_before, job.bridge_after );
+  }
+  else
+  {
+    copy( job.from, job.from + job.size, job.out );
+  }
+}
+
+void RenderSystem::queue( const Job &job )
+{ // without workers there is nothing to wait for
+  if( mPool )
+  {
+    mJobs.push_back( job );
+  }
+  else
+  {
+    runJob( job );
+  }
+}
+
+void RenderSystem::runJobs()
+{ // every job writes its own range, so they can run in any order on any thread
+  const size_t chunk = 256;
+  if( !mPool || mJobs.size() < chunk * 2 )
+  {
+    for( const auto &job : mJobs )
+    {
+      runJob( job );
+    }
+    return;
+  }
+  mNextJob = 0;
+  auto work = [this, chunk]( size_t ) {
+    for( size_t begin = mNextJob.fetch_add( chunk ); begin < mJobs.size(); begin = mNextJob.fetch_add( chunk ) )
+    {
+      const size_t end = std::min( begin + chunk, mJobs.size() );
+      for( size_t i = begin; i < end; ++i )
+      {
+        runJob( mJobs[i] );
       }
-      for( auto &vert : mesh->vertices )
+    }
+    mWorking -= 1;
+  };
+  const size_t slot = mPool->external_slot();
+  mWorking = mPool->size() + 1;
+  for( size_t i = 0; i < mPool->size(); ++i )
+  {
+    mPool->submit( work, slot );
+  }
+  work( slot );
+  // help out until every worker has finished
+  while( mWorking > 0 )
+  {
+    if( !mPool->run_one( slot ) )
+    {
+      this_thread::yield();
+    }
+  }
+}
+
+size_t RenderSystem::vertexCount( const RenderData &data )
+{
+  if( data.quad ){ return 4; }
+  if( data.mesh ){ return data.mesh->vertices.size(); }
+  if( data.trail ){ return data.trail->vertices().size(); }
+  if( data.geometry ){ return data.geometry->vertices.size(); }
+  return 0;
+}
+
+bool RenderSystem::checkChanged( RenderData &data ) const
+{
+  auto &assembled = data.mAssembled;
+  bool changed = false;
+  const uint64_t locus_revision = data.locus->revision( mInterpolation );
+  if( locus_revision != assembled.locus_revision )
+  {
+    assembled.locus_revision = locus_revision;
+    changed = true;
+  }
+  // what we draw; the first of these that we have is drawn
+  const void *source = nullptr;
+  uint64_t source_revision = 0;
+  if( data.quad )
+  { // quads are edited directly, so compare them with a copy
+    const SpriteQuad &quad = *data.quad;
+    const SpriteQuad &last = assembled.quad;
+    source = &quad;
+    if( quad.size != last.size || quad.registration_point != last.registration_point || quad.color != last.color
+       || quad.texture_bounds.x1 != last.texture_bounds.x1 || quad.texture_bounds.y1 != last.texture_bounds.y1
+       || quad.texture_bounds.x2 != last.texture_bounds.x2 || quad.texture_bounds.y2 != last.texture_bounds.y2 )
+    {
+      assembled.quad = quad;
+      changed = true;
+    }
+  }
+  else if( data.mesh )
+  {
+    source = data.mesh.get();
+    source_revision = data.mesh->revision();
+  }
+  else if( data.trail )
+  {
+    source = data.trail.get();
+    source_revision = data.trail->revision();
+  }
+  else if( data.geometry )
+  { // geometry never changes, but our color and texture bounds might
+    source = data.geometry.get();
+    const Rectf &bounds = data.texture_bounds;
+    const Rectf &last = assembled.texture_bounds;
+    if( data.geometry != assembled.geometry || data.color != assembled.color
+       || bounds.x1 != last.x1 || bounds.y1 != last.y1 || bounds.x2 != last.x2 || bounds.y2 != last.y2 )
+    {
+      assembled.geometry = data.geometry;
+      assembled.color = data.color;
+      assembled.texture_bounds = bounds;
+      changed = true;
+    }
+  }
+  if( source != assembled.source || source_revision != assembled.source_revision )
+  {
+    assembled.source = source;
+    assembled.source_revision = source_revision;
+    changed = true;
+  }
+  return changed;
+}
+
+void RenderSystem::assemble( const RenderData &data, Vertex *out, bool bridge_before, bool bridge_after ) const
+{
+  auto mat = data.locus->toMatrix( mInterpolation );
+  Vertex *v = out;
+  if( data.quad )
+  { // corners in the same order as RenderMesh::matchTexture
+    const SpriteQuad &quad = *data.quad;
+    const Rectf &uv = quad.texture_bounds;
+    Vec2f ul = -quad.registration_point;
+    Vec2f lr = quad.size - quad.registration_point;
+    v += bridge_before;
+    *v++ = Vertex{ mat.transformPoint( Vec2f{ lr.x, ul.y } ), quad.color, uv.getUpperRight() };
+    *v++ = Vertex{ mat.transformPoint( ul ), quad.color, uv.getUpperLeft() };
+    *v++ = Vertex{ mat.transformPoint( lr ), quad.color, uv.getLowerRight() };
+    *v++ = Vertex{ mat.transformPoint( Vec2f{ ul.x, lr.y } ), quad.color, uv.getLowerLeft() };
+  }
+  else if( data.mesh )
+  {
+    v += bridge_before;
+    for( auto &vert : data.mesh->vertices )
+    {
+      *v++ = Vertex{ mat.transformPoint( vert.position ), vert.color, vert.tex_coord };
+    }
+  }
+  else if( data.trail )
+  { // the ring from its head to the end, then around from the start
+    const auto &verts = data.trail->vertices();
+    const size_t head = data.trail->headVertex();
+    v += bridge_before;
+    for( size_t i = head; i < verts.size(); ++i )
+    {
+      *v++ = Vertex{ mat.transformPoint( verts[i].position ), verts[i].color, verts[i].tex_coord };
+    }
+    for( size_t i = 0; i < head; ++i )
+    {
+      *v++ = Vertex{ mat.transformPoint( verts[i].position ), verts[i].color, verts[i].tex_coord };
+    }
+  }
+  else
+  { // shared geometry, in our color and with tex coords mapped into our texture bounds
+    const auto &geometry = *data.geometry;
+    const Rectf &from = geometry.texture_bounds;
+    const Rectf &to = data.texture_bounds;
+    Vec2f uv_scale{ from.getWidth() > 0.0f ? to.getWidth() / from.getWidth() : 1.0f,
+                    from.getHeight() > 0.0f ? to.getHeight() / from.getHeight() : 1.0f };
+    Vec2f uv_offset = to.getUpperLeft() - from.getUpperLeft() * uv_scale;
+    ColorA8u color = data.color;
+    v += bridge_before;
+    for( const auto &vert : geometry.vertices )
+    {
+      *v++ = Vertex{ mat.transformPoint( vert.position ), color, uv_offset + vert.tex_coord * uv_scale };
+    }
+  }
+  // degenerate triangles between the previous shape's last vertex and our first, and our last and the next's first
+  if( bridge_before )
+  {
+    out[0] = out[1];
+  }
+  if( bridge_after )
+  {
+    *v = v[-1];
+  }
+}
+
+void RenderSystem::fileAdded()
+{ // new render data is checked every frame unless it promises to stay put
+  for( auto *data : mUnfiled )
+  {
+    if( data->stationary )
+    {
+      mStationary.push_back( data );
+      mGridDirty = true;
+    }
+    else
+    {
+      mMoving.push_back( data );
+    }
+  }
+  mUnfiled.clear();
+}
+
+void RenderSystem::cull()
+{
+  if( mOrderDirty )
+  { // number every render data by its place in its pass
+    for( auto &geometry : mGeometry )
+    {
+      for( size_t i = 0; i < geometry.size(); ++i )
+      {
+        geometry[i]->mDrawOrder = i;
+      }
+    }
+    mOrderDirty = false;
+  }
+  if( mGridDirty )
+  {
+    fileStationary();
+  }
+  for( auto &visible : mVisible )
+  {
+    visible.clear();
+  }
+  auto consider = [this]( RenderData *data ) {
+    if( data->worldBounds( mInterpolation ).intersects( mViewRect ) )
+    {
+      mVisible[data->pass].push_back( data );
+    }
+  };
+  for( auto *data : mMoving )
+  {
+    consider( data );
+  }
+  for( auto *data : mOversized )
+  {
+    consider( data );
+  }
+  // stationary render data from the grid cells under the view; each is seen once, however many cells it spans
+  ++mCullQuery;
+  auto visit = [&]( const vector<RenderData*> &cell ) {
+    for( auto *data : cell )
+    {
+      if( data->mCullQuery != mCullQuery )
+      {
+        data->mCullQuery = mCullQuery;
+        consider( data );
+      }
+    }
+  };
+  int x1 = math<float>::floor( mViewRect.x1 / mCellSize );
+  int y1 = math<float>::floor( mViewRect.y1 / mCellSize );
+  int x2 = math<float>::floor( mViewRect.x2 / mCellSize );
+  int y2 = math<float>::floor( mViewRect.y2 / mCellSize );
+  if( size_t( x2 - x1 + 1 ) * size_t( y2 - y1 + 1 ) > mGrid.size() )
+  { // the view covers more cells than are filled
+    for( const auto &cell : mGrid )
+    {
+      visit( cell.second );
+    }
+    return;
+  }
+  for( int y = y1; y <= y2; ++y )
+  {
+    for( int x = x1; x <= x2; ++x )
+    {
+      auto iter = mGrid.find( cellKey( x, y ) );
+      if( iter != mGrid.end() )
+      {
+        visit( iter->second );
+      }
+    }
+  }
+}
+
+void RenderSystem::fileStationary()
+{
+  mGrid.clear();
+  mOversized.clear();
+  for( auto *data : mStationary )
+  {
+    const Rectf &bounds = data->worldBounds();
+    int x1 = math<float>::floor( bounds.x1 / mCellSize );
+    int y1 = math<float>::floor( bounds.y1 / mCellSize );
+    int x2 = math<float>::floor( bounds.x2 / mCellSize );
+    int y2 = math<float>::floor( bounds.y2 / mCellSize );
+    if( size_t( x2 - x1 + 1 ) * size_t( y2 - y1 + 1 ) > 16 )
+    { // big things are cheaper to check than to file everywhere
+      mOversized.push_back( data );
+      continue;
+    }
+    for( int y = y1; y <= y2; ++y )
+    {
+      for( int x = x1; x <= x2; ++x )
       {
-        v.emplace_back( Vertex{ mat.transformPoint( vert.position ), vert.color, vert.tex_coord } );
+        mGrid[cellKey( x, y )].push_back( data );
       }
     }
   }
+  mGridDirty = false;
 }
 
+#ifndef PUPTENT_HEADLESS
 void RenderSystem::draw() const
 {
 //  float x = 400; // left
@@ -179,3 +730,4 @@ void RenderSystem::draw() const
     gl::disable( GL_TEXTURE_2D );
   }
 }
+#endif
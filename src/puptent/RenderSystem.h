@@ -27,6 +27,8 @@
 
 #pragma once
 
+#include <atomic>
+#include <unordered_map>
 #include "puptent/PupTent.h"
 #include "puptent/Locus.h"
 #include "puptent/RenderMesh.h"
@@ -51,6 +53,8 @@ namespace puptent
    Composite component.
    Lets us store information needed for RenderSystem in one fast-to-access place.
    Requires an extra step when defining element components
+   Draws a SpriteQuad, a RenderMesh, a RibbonTrail or shared MeshGeometry. Geometry is
+   drawn in our color, with its texture coordinates moved into our texture_bounds.
    */
   typedef std::shared_ptr<class RenderData> RenderDataRef;
   struct RenderData : Component<RenderData>
@@ -61,10 +65,85 @@ namespace puptent
     render_layer( render_layer ),
     pass( pass )
     {}
+    RenderData( SpriteQuadRef quad, LocusRef locus, int render_layer=0, RenderPass pass=eNormalPass ):
+    quad( quad ),
+    locus( locus ),
+    render_layer( render_layer ),
+    pass( pass )
+    {}
+    RenderData( RibbonTrailRef trail, LocusRef locus, int render_layer=0, RenderPass pass=eNormalPass ):
+    trail( trail ),
+    locus( locus ),
+    render_layer( render_layer ),
+    pass( pass )
+    {}
+    RenderData( MeshGeometryRef geometry, LocusRef locus, int render_layer=0, RenderPass pass=eNormalPass ):
+    locus( locus ),
+    render_layer( render_layer ),
+    pass( pass )
+    {
+      setGeometry( geometry );
+    }
+    //! draw \a geometry with its own texture bounds
+    void setGeometry( MeshGeometryRef geometry )
+    {
+      this->geometry = geometry;
+      texture_bounds = geometry->texture_bounds;
+    }
+    //! drawn in preference to a mesh, trail or geometry
+    SpriteQuadRef     quad;
     RenderMeshRef     mesh;
+    RibbonTrailRef    trail;
+    //! shared vertices, drawn when there is no quad, mesh or trail
+    MeshGeometryRef   geometry;
+    //! replaces the color of the geometry's vertices
+    ci::ColorA8u      color = ci::ColorA8u::white();
+    //! where on the sprite sheet the geometry's texture coordinates are moved to
+    ci::Rectf         texture_bounds;
     LocusRef          locus;
     int               render_layer;
     const RenderPass  pass;
+    //! promise that we never move or change how we look, like scenery; set before the next RenderSystem update
+    //! a culling RenderSystem then finds us through its spatial grid instead of checking us every frame,
+    //! and an unculled one leaves our vertices as first assembled without checking us for changes
+    //! (debug builds check, and assert if we changed anyway)
+    bool              stationary = false;
+    //! bounds of what we draw, before the locus transform
+    ci::Rectf         localBounds() const;
+    //! localBounds() transformed by our locus, as drawn at \a alpha of the way between steps
+    //! cached until the shape or the locus' transform changes; reading writes the cache, as with Locus
+    const ci::Rectf&  worldBounds() const;
+    const ci::Rectf&  worldBounds( float alpha ) const;
+  private:
+    friend struct RenderSystem;
+    const ci::Rectf&  worldBounds( uint64_t locus_revision, const ci::MatrixAffine2f &transform ) const;
+    //! our place in our pass and the last cull query that found us; kept by RenderSystem
+    size_t            mDrawOrder = 0;
+    uint64_t          mCullQuery = 0;
+    //! where RenderSystem last wrote our vertices and what they were made from
+    //! while nothing here changes, it leaves them as they are
+    struct Assembled
+    {
+      //! our range of the pass' vertices, including those bridging to our neighbors
+      size_t          offset = 0;
+      size_t          size = 0;
+      bool            bridge_before = false;
+      bool            bridge_after = false;
+      uint64_t        locus_revision = 0;
+      //! the quad, mesh, trail or geometry drawn, and the revision of a mesh or trail
+      const void      *source = nullptr;
+      uint64_t        source_revision = 0;
+      //! quads and our color and texture bounds have no revision, so we keep copies
+      SpriteQuad      quad;
+      MeshGeometryRef geometry;
+      ci::ColorA8u    color;
+      ci::Rectf       texture_bounds;
+    };
+    Assembled         mAssembled;
+    mutable ci::Rectf mWorldBounds;
+    //! the local bounds and locus revision mWorldBounds was built from
+    mutable ci::Rectf mWorldBoundsLocal;
+    mutable uint64_t  mWorldBoundsRevision = 0;
   };
 
   /**
@@ -96,22 +175,126 @@ namespace puptent
     //! sort the render data in the normal pass by render layer
     //! needed if you are dynamically changing Locus render_layers
     inline void sort()
-    { stable_sort( mGeometry[eNormalPass].begin(), mGeometry[eNormalPass].end(), &RenderSystem::layerSort ); }
+    {
+      stable_sort( mGeometry[eNormalPass].begin(), mGeometry[eNormalPass].end(), &RenderSystem::layerSort );
+      mOrderDirty = true;
+      mLayoutDirty[eNormalPass] = true;
+    }
+    //! reads meshes and loci through RenderData
+    void        declare( SystemAccess &access ) override;
     //! generate vertex list by transforming meshes by locii
+    //! when updated per-frame after fixed steps, loci are interpolated between steps
+    //! without a view rect, each render data keeps its range of the vertices between updates
+    //! and is only transformed again once its locus, mesh, trail or quad changes
     void        update( EntityManagerRef es, EventManagerRef events, double dt ) override;
+#ifndef PUPTENT_HEADLESS
     //! batch render scene to screen
     void        draw() const;
+#endif
+    //! only draw render data whose world bounds touch \a view, given in the same space as the loci
+    //! cost then scales with what is on screen; stationary render data is found through a spatial grid
+    void        setViewRect( const ci::Rectf &view ){ mViewRect = view; mCulling = true; }
+    //! draw everything again
+    void        clearViewRect(){ mCulling = false; }
+    //! width and height of the grid cells stationary render data is filed in
+    void        setCullCellSize( float size ){ mCellSize = size; mGridDirty = true; }
+    //! render data drawn and skipped by the last update
+    size_t      getDrawnCount() const { return mDrawnCount; }
+    size_t      getCulledCount() const { return mCulledCount; }
+    //! number of threads, besides the caller, that assemble vertices; defaults to zero
+    //! the vertices are the same however many there are
+    void        setWorkerThreads( size_t count );
+#ifndef PUPTENT_HEADLESS
     //! set a texture to be bound for all rendering
     inline void setTexture( ci::gl::TextureRef texture )
     { mTexture = texture; }
-    void        receive( const EntityDestroyedEvent &event );
-    void        receive( const ComponentAddedEvent<RenderData> &event );
+#endif
+    //! drop render data of destroyed entities, one erase per pass per batch
+    void        receive( span<const EntityDestroyedEvent> events );
+    //! file new render data under its pass; queue ComponentAddedEvent<RenderData>
+    //! to sort large numbers of additions into the normal pass in one merge
+    void        receive( span<const ComponentAddedEvent<RenderData>> events );
     void        receive( const ComponentRemovedEvent<RenderData> &event );
+    //! remember how far between fixed steps this frame falls
+    void        receive( const FixedStepEvent &event );
     void        checkOrdering() const;
+    //! the vertices assembled for \a pass by the last update
+    const std::vector<Vertex>&  getVertices( RenderPass pass ) const { return mVertices[pass]; }
   private:
     std::array<std::vector<RenderDataRef>, 3>  mGeometry;
     std::array<std::vector<Vertex>, 3>         mVertices;
+    // render data was added, removed or reordered, so ranges must move
+    std::array<bool, 3>                        mLayoutDirty = {{ true, true, true }};
+    // the vertices hold a culled batch instead of every range
+    bool                                       mReassemble = true;
+    // scratch space for laying ranges out again
+    std::vector<size_t>                        mCounts;
+    std::array<std::vector<Vertex>, 3>         mLaidOut;
+    //! a range of vertices to write: \a data's, transformed, or \a size vertices copied \a from an earlier layout
+    struct Job
+    {
+      RenderData        *data;
+      const Vertex      *from;
+      Vertex            *out;
+      size_t            size;
+      bool              bridge_before;
+      bool              bridge_after;
+    };
+    // ranges placed by this update, written across the worker threads once all are placed
+    std::vector<Job>                           mJobs;
+    std::shared_ptr<TaskPool>                  mPool;
+    std::atomic<size_t>                        mNextJob{ 0 };
+    std::atomic<size_t>                        mWorking{ 0 };
+#ifndef PUPTENT_HEADLESS
     ci::gl::TextureRef                         mTexture;
+#endif
+    // fraction of the way from the previous fixed step to the latest; 1 shows the latest
+    float                                      mInterpolation = 1.0f;
+    // render data by owning entity id, so destroyed entities need no component lookup
+    std::unordered_map<uint64_t, RenderDataRef> mEntityData;
+    std::vector<const RenderData*>             mDestroyed;
+    // scratch space for merging batches of additions into the normal pass
+    std::vector<RenderDataRef>                 mAdded;
+    std::vector<RenderDataRef>                 mMerged;
+    //! queue rewrites of the ranges of render data that changed, and moves of the rest if any range moved
+    void        assembleAll( RenderPass pass );
+    void        runJob( const Job &job ) const;
+    //! write a range now, or once every range is placed when there are worker threads
+    void        queue( const Job &job );
+    //! write every queued range, across the worker threads if there are any
+    void        runJobs();
+    //! write \a data's vertices to \a out, led and followed by copies of its first and last
+    //! vertex to bridge it with degenerate triangles to its neighbors in the strip
+    void        assemble( const RenderData &data, Vertex *out, bool bridge_before, bool bridge_after ) const;
+    //! number of vertices \a data draws, without bridges
+    static size_t vertexCount( const RenderData &data );
+    //! whether \a data's vertices changed since they were last assembled; remembers what they are made from now
+    bool        checkChanged( RenderData &data ) const;
+    //! sort new render data into moving and stationary
+    void        fileAdded();
+    //! fill mVisible with render data touching the view rect
+    void        cull();
+    //! rebuild the grid of stationary render data
+    void        fileStationary();
+    static uint64_t             cellKey( int x, int y )
+    { return (uint64_t( uint32_t( x ) ) << 32) | uint32_t( y ); }
+    // culling: render data not yet filed, render data checked every frame,
+    // and stationary render data, in grid cells or too big for them
+    bool                                       mCulling = false;
+    ci::Rectf                                  mViewRect;
+    float                                      mCellSize = 512.0f;
+    std::vector<RenderData*>                   mUnfiled;
+    std::vector<RenderData*>                   mMoving;
+    std::vector<RenderData*>                   mStationary;
+    std::vector<RenderData*>                   mOversized;
+    std::unordered_map<uint64_t, std::vector<RenderData*>> mGrid;
+    bool                                       mGridDirty = false;
+    // mDrawOrder of every render data needs renumbering
+    bool                                       mOrderDirty = true;
+    uint64_t                                   mCullQuery = 0;
+    std::array<std::vector<RenderData*>, 3>    mVisible;
+    size_t                                     mDrawnCount = 0;
+    size_t                                     mCulledCount = 0;
     static bool                 layerSort( const RenderDataRef &lhs, const RenderDataRef &rhs )
     { return lhs->render_layer < rhs->render_layer; }
     // maybe add a CameraRef for positioning the scene
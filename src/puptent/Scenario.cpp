@@ -0,0 +1,364 @@
+/*
+ * Copyright (c) 2013 David Wicks, sansumbrella.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "puptent/Scenario.h"
+#include "cinder/DataSource.h"
+#include "cinder/Json.h"
+#include "cinder/Rand.h"
+#include "cinder/Easing.h"
+
+#include "entityx/tags/TagsComponent.h"
+#include "pockets/AnimationUtils.h"
+#include "puptent/RenderSystem.h"
+#include "puptent/ParticleSystem.h"
+#include "puptent/ExpiresSystem.h"
+#include "puptent/ScriptSystem.h"
+
+using namespace puptent;
+using namespace cinder;
+using namespace std;
+
+namespace
+{
+  template<typename T>
+  T valueOr( const JsonTree &json, const string &key, T fallback )
+  {
+    return json.hasChild( key ) ? json[key].getValue<T>() : fallback;
+  }
+}
+
+Scenario::Scenario( const fs::path &path )
+{
+  JsonTree json{ loadFile( path ) };
+  frames = valueOr( json, "frames", frames );
+  step = valueOr( json, "step", step );
+  seed = valueOr( json, "seed", seed );
+  size.x = valueOr( json, "width", size.x );
+  size.y = valueOr( json, "height", size.y );
+  view.x = valueOr( json, "view_width", view.x );
+  view.y = valueOr( json, "view_height", view.y );
+  treasures = valueOr( json, "treasures", treasures );
+  respawn = valueOr( json, "respawn", respawn );
+  sprite_drawing = valueOr( json, "sprite_drawing", sprite_drawing );
+  players = valueOr( json, "players", players );
+  planets = valueOr( json, "planets", planets );
+  ships = valueOr( json, "ships", ships );
+  ribbons = valueOr( json, "ribbons", ribbons );
+  particles = valueOr( json, "particles", particles );
+  chains = valueOr( json, "chains", chains );
+  chain_depth = valueOr( json, "chain_depth", chain_depth );
+  atlas = path.parent_path() / valueOr<string>( json, "atlas", "spritesheet.json" );
+  animations = path.parent_path() / valueOr<string>( json, "animations", "animations.json" );
+}
+
+void Scenario::populate( EntityManagerRef entities, SpriteAnimationSystemRef sprites, KeyboardInputRef input ) const
+{
+  Rand::randSeed( seed );
+  for( int i = 0; i < players; ++i )
+  {
+    createPlayer( entities, sprites );
+  }
+  // respawning treasures share one copy of the scenario and don't keep the world alive
+  shared_ptr<const Scenario> self = respawn ? make_shared<Scenario>( *this ) : nullptr;
+  for( int i = 0; i < treasures; ++i )
+  {
+    if( self ){ createRespawningTreasure( self, entities, sprites ); }
+    else { createTreasure( entities, sprites ); }
+  }
+  for( int i = 0; i < planets; ++i )
+  {
+    createPlanet( entities );
+  }
+  for( int i = 0; i < ships; ++i )
+  {
+    createShip( entities, input );
+  }
+  for( int i = 0; i < ribbons; ++i )
+  {
+    createRibbon( entities );
+  }
+  for( int i = 0; i < particles; ++i )
+  {
+    createParticle( entities );
+  }
+  for( int i = 0; i < chains; ++i )
+  {
+    createChain( entities );
+  }
+}
+
+Entity Scenario::createTreasure( EntityManagerRef entities, SpriteAnimationSystemRef sprites ) const
+{
+  auto entity = entities->create();
+  auto loc = shared_ptr<Locus>{ new Locus };
+  auto anim = sprites->createSpriteAnimation( "dot" );
+  anim->current_index = Rand::randInt( 0, 10 );
+  loc->position = { Rand::randFloat( size.x ), Rand::randFloat( size.y ) };
+  loc->rotation = Rand::randFloat( M_PI * 2 );
+  loc->registration_point = { 20.0f, 10.0f };
+  ColorA8u color = Color::gray( Rand::randFloat( 0.4f, 1.0f ) );
+  if( sprite_drawing == "shared" )
+  {
+    auto data = entity.assign<RenderData>( sprites->getGeometry( *anim ), loc, Rand::randInt( 50 ), eNormalPass );
+    data->color = color;
+    entity.assign( anim );
+    entity.assign( loc );
+  }
+  else if( sprite_drawing == "quads" )
+  {
+    auto quad = entity.assign<SpriteQuad>();
+    quad->color = color;
+    entity.assign( anim );
+    entity.assign( loc );
+    entity.assign<RenderData>( quad, loc, Rand::randInt( 50 ), eNormalPass );
+  }
+  else
+  {
+    auto mesh = entity.assign<RenderMesh>( 4 );
+    mesh->setColor( color );
+    entity.assign( anim );
+    entity.assign( loc );
+    entity.assign<RenderData>( mesh, loc, Rand::randInt( 50 ), eNormalPass );
+  }
+  // same lifetimes as the sample app, weighted toward the end
+  entity.assign<Expires>( easeOutQuad( Rand::randFloat() ) * 5.0f + 1.0f );
+  entity.assign<tags::TagsComponent>( "treasure" );
+  return entity;
+}
+
+Entity Scenario::createRespawningTreasure( shared_ptr<const Scenario> scenario, std::weak_ptr<EntityManager> entities, std::weak_ptr<SpriteAnimationSystem> sprites )
+{
+  auto entity = scenario->createTreasure( entities.lock(), sprites.lock() );
+  entity.component<Expires>()->callback = [=](){
+    if( ! entities.expired() && ! sprites.expired() )
+    {
+      createRespawningTreasure( scenario, entities, sprites );
+    }
+  };
+  return entity;
+}
+
+Entity Scenario::createPlayer( EntityManagerRef entities, SpriteAnimationSystemRef sprites ) const
+{ // drifts about, eating any treasure that comes near
+  auto player = entities->create();
+  auto loc = shared_ptr<Locus>{ new Locus };
+  auto anim = sprites->createSpriteAnimation( "jellyfish" );
+  loc->position = size * 0.5f;
+  loc->rotation = Rand::randFloat( M_PI * 2 );
+  loc->registration_point = { 20.0f, 10.0f };
+  auto mesh = player.assign<RenderMesh>( 4 );
+  player.assign( anim );
+  player.assign( loc );
+  player.assign<RenderData>( mesh, loc, 1 );
+  auto verlet = player.assign<Particle>( loc );
+  verlet->friction = 0.9f;
+  verlet->rotation_friction = 0.5f;
+  auto view = tags::TagsComponent::view( entities->entities_with_components<Locus>(), "treasure" );
+  player.assign<CppScriptComponent>( [=]( Entity self, double dt ){
+    auto locus = self.component<Locus>();
+    for( auto entity : view )
+    {
+      if( entity.component<Locus>()->position.distance( locus->position ) < 50.0f )
+      {
+        entity.destroy();
+      }
+    }
+  } );
+  return player;
+}
+
+Entity Scenario::createPlanet( EntityManagerRef entities ) const
+{
+  Entity planet = entities->create();
+  float planet_size = 200.0f;
+  auto loc = planet.assign<Locus>();
+  auto mesh = planet.assign<RenderMesh>();
+  mesh->setAsCircle( Vec2f{ planet_size, planet_size } );
+  mesh->setColor( Color::gray( 0.8f ) );
+  planet.assign<RenderData>( mesh, loc, 0 );
+  loc->position = Vec2f{ Rand::randFloat( size.x ), Rand::randFloat( size.y ) };
+  // spin slowly, so the moons' world transforms change every frame
+  planet.assign<CppScriptComponent>( [=]( Entity self, double dt ){
+    loc->rotation += dt * 0.1f;
+  } );
+
+  for( int i = 0; i < 10; ++i )
+  {
+    Entity e = entities->create();
+    auto mesh = e.assign<RenderMesh>( 3 );
+    mesh->setAsTriangle( Vec2f{ 0.0f, 0.0f }, Vec2f{ 30.0f, 45.0f }, Vec2f{ -30.0f, 45.0f } );
+    mesh->setColor( Color( CM_HSV, 0.25f, 1.0f, 1.0f ) );
+    auto locus = e.assign<Locus>();
+    locus->parent = loc;
+    locus->position = Vec2f{ Rand::randFloat( -1.0f, 1.0f ), Rand::randFloat( -1.0f, 1.0f ) } * planet_size * 0.5f;
+    locus->registration_point = Vec2f{ 0.0f, 20.0f };
+    locus->rotation = Rand::randFloat( M_PI );
+    locus->scale = Rand::randFloat( 0.5f, 4.0f );
+    e.assign<RenderData>( mesh, locus, 1, RenderPass::eMultiplyPass );
+  }
+  return planet;
+}
+
+Entity Scenario::createShip( EntityManagerRef entities, KeyboardInputRef input ) const
+{ // the sample app's ship; without input, it flies in a circle
+  Entity ship = entities->create();
+  auto loc = ship.assign<Locus>();
+  Vec2f center = size * 0.5f;
+  float radius = Rand::randFloat( 50.0f, size.y * 0.5f );
+  float angle = Rand::randFloat( M_PI * 2 );
+  loc->position = center + Vec2f{ cos( angle ), sin( angle ) } * radius;
+  auto verlet = ship.assign<Particle>( loc );
+  verlet->friction = 0.9f;
+  verlet->rotation_friction = 0.0f;
+
+  float hues[] = { 0.55f, 0.65f };
+  Entity wings[2];
+  for( int side = 0; side < 2; ++side )
+  {
+    float direction = side == 0 ? -1.0f : 1.0f;
+    Entity wing = entities->create();
+    auto locus = wing.assign<Locus>();
+    auto mesh = wing.assign<RenderMesh>( 3 );
+    mesh->setAsTriangle( Vec2f{ 0.0f, 0.0f }, Vec2f{ 20.0f * direction, 40.0f }, Vec2f{ 0.0f, 40.0f } );
+    mesh->setColor( Color( CM_HSV, hues[side], 1.0f, 1.0f ) );
+    locus->parent = loc;
+    locus->rotation = -direction * M_PI * 0.05f;
+    locus->position = Vec2f{ direction, 0.0f };
+    wing.assign<RenderData>( mesh, locus, 5 );
+    wings[side] = wing;
+  }
+
+  if( input )
+  { // steered by the arrow keys; d breaks off the wings
+    Entity left_wing = wings[0], right_wing = wings[1];
+    ship.assign<CppScriptComponent>( [=]( Entity self, double dt ) mutable
+                                    {
+                                      auto verlet = self.component<Particle>();
+                                      Vec2f delta = loc->position - verlet->p_position;
+                                      loc->position += input->getForce() * dt * 100.0f;
+                                      if( delta.lengthSquared() > EPSILON_VALUE )
+                                      {
+                                        loc->rotation = wrapLerp( loc->rotation, (float)M_PI * 0.5f + math<float>::atan2( delta.y, delta.x ), (float)M_PI * 2, 0.2f );
+                                      }
+                                      if( input->takeKeyPressed( app::KeyEvent::KEY_d ) && left_wing.valid() && left_wing.component<Locus>()->parent )
+                                      {
+                                        for( auto wing : { left_wing, right_wing } )
+                                        {
+                                          auto wing_loc = wing.component<Locus>();
+                                          auto p = wing.assign<Particle>( wing_loc );
+                                          p->rotation_friction = 0.99f;
+                                          p->friction = 0.99f;
+                                          wing_loc->detachFromParent();
+                                          wing_loc->position += input->getForce() * dt * 100.0f + Rand::randVec2f() * 10.0f;
+                                          wing_loc->rotation += Rand::randFloat( M_PI * 0.1f );
+                                        }
+                                      }
+                                    } );
+  }
+  else
+  {
+    ship.assign<CppScriptComponent>( [=]( Entity self, double dt ) mutable
+                                    {
+                                      angle += dt;
+                                      loc->position = center + Vec2f{ cos( angle ), sin( angle ) } * radius;
+                                      loc->rotation = angle + M_PI;
+                                    } );
+  }
+
+  Entity trail = entities->create();
+  auto locus = trail.assign<Locus>();
+  auto ribbon = trail.assign<RibbonTrail>( 11, loc->toMatrix().transformPoint( { 0.0f, 40.0f } ), 4.0f );
+  trail.assign<RenderData>( ribbon, locus, 4 );
+  trail.assign<CppScriptComponent>( [=]( Entity self, double dt )
+                                   {
+                                     ribbon->push( loc->toMatrix().transformPoint( { 0.0f, 40.0f } ) );
+                                   } );
+  return ship;
+}
+
+Entity Scenario::createRibbon( EntityManagerRef entities ) const
+{
+  Entity e = entities->create();
+  auto loc = e.assign<Locus>();
+  auto mesh = e.assign<RenderMesh>( 100 );
+  e.assign<RenderData>( mesh, loc );
+  loc->position = Vec2f{ Rand::randFloat( size.x ), Rand::randFloat( size.y ) };
+  vector<Vec2f> positions;
+  for( int i = 0; i < 50; ++i )
+  {
+    positions.push_back( Vec2f{ i * 10.0f, sin( i * 0.2f ) * 50.0f } );
+  }
+  mesh->setAsRibbon( positions, 20.0f, false );
+  return e;
+}
+
+Entity Scenario::createParticle( EntityManagerRef entities ) const
+{ // a spark thrown out from the middle, slowing as it goes
+  Entity e = entities->create();
+  auto loc = e.assign<Locus>();
+  loc->position = size * 0.5f + Rand::randVec2f() * Rand::randFloat( size.y * 0.25f );
+  loc->rotation = Rand::randFloat( M_PI * 2 );
+  auto verlet = e.assign<Particle>( loc );
+  // the previous step's position sets the starting velocity
+  verlet->p_position = loc->position - Rand::randVec2f() * Rand::randFloat( 0.5f, 4.0f );
+  verlet->p_rotation = loc->rotation - Rand::randFloat( -0.1f, 0.1f );
+  verlet->friction = 0.995f;
+  verlet->rotation_friction = 1.0f;
+  auto mesh = e.assign<RenderMesh>( 4 );
+  mesh->setAsBox( Rectf{ -2.0f, -2.0f, 2.0f, 2.0f } );
+  mesh->setColor( Color( CM_HSV, Rand::randFloat( 0.05f, 0.15f ), 1.0f, 1.0f ) );
+  e.assign<RenderData>( mesh, loc, 2 );
+  return e;
+}
+
+Entity Scenario::createChain( EntityManagerRef entities ) const
+{ // only the root turns, but every link's world transform changes with it
+  Entity root = entities->create();
+  auto loc = root.assign<Locus>();
+  loc->position = Vec2f{ Rand::randFloat( size.x ), Rand::randFloat( size.y ) };
+  float speed = Rand::randFloat( -1.0f, 1.0f );
+  root.assign<CppScriptComponent>( [=]( Entity self, double dt ){
+    loc->rotation += dt * speed;
+  } );
+
+  LocusRef parent = loc;
+  for( int i = 0; i < chain_depth; ++i )
+  {
+    Entity link = entities->create();
+    auto locus = link.assign<Locus>();
+    locus->parent = parent;
+    locus->position = Vec2f{ 0.0f, 12.0f };
+    locus->rotation = Rand::randFloat( -0.2f, 0.2f );
+    locus->scale = 0.98f;
+    auto mesh = link.assign<RenderMesh>( 3 );
+    mesh->setAsTriangle( Vec2f{ -4.0f, 0.0f }, Vec2f{ 4.0f, 0.0f }, Vec2f{ 0.0f, 12.0f } );
+    mesh->setColor( Color( CM_HSV, 0.8f, 0.6f, 1.0f ) );
+    link.assign<RenderData>( mesh, locus, 3 );
+    parent = locus;
+  }
+  return root;
+}
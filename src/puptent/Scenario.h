@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2013 David Wicks, sansumbrella.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+#include "puptent/PupTent.h"
+#include "puptent/SpriteSystem.h"
+#include "puptent/KeyboardInput.h"
+#include "cinder/Filesystem.h"
+
+namespace puptent
+{
+  /**
+   Scenario:
+   A world to simulate without a window: how many of each kind of entity
+   to create, how many frames to step and how long each step is.
+   Loaded from json; every key is optional. See samples/Headless/assets/default.json.
+   Sprite sheet and animation paths are relative to the scenario file.
+   */
+  struct Scenario
+  {
+    explicit Scenario( const ci::fs::path &path );
+    //! create the scenario's entities
+    //! seeds Rand first, so every run of a scenario builds the same world
+    //! ships fly themselves unless given \a input to steer them with
+    void populate( EntityManagerRef entities, SpriteAnimationSystemRef sprites, KeyboardInputRef input = nullptr ) const;
+
+    int           frames = 600;
+    double        step = 1.0 / 60.0;
+    uint32_t      seed = 214;
+    //! the area entities are spread over, like a window
+    ci::Vec2f     size = ci::Vec2f( 1024.0f, 768.0f );
+    //! when set, RenderSystem only draws what touches a view this big at the origin
+    ci::Vec2f     view = ci::Vec2f::zero();
+    int           treasures = 1000;
+    //! replace each treasure as it expires, keeping their number steady
+    bool          respawn = false;
+    //! how treasures are drawn: "meshes", each with its own RenderMesh;
+    //! "shared", from their animation frame's shared geometry; or "quads", as SpriteQuads
+    std::string   sprite_drawing = "meshes";
+    //! treasure eaters, like the sample app's jellyfish
+    int           players = 0;
+    int           planets = 1;
+    int           ships = 1;
+    int           ribbons = 1;
+    //! free verlet particles, thrown out from the middle
+    int           particles = 0;
+    //! arms of chain_depth loci, each parented to the one before
+    int           chains = 0;
+    int           chain_depth = 16;
+    ci::fs::path  atlas;
+    ci::fs::path  animations;
+  private:
+    Entity createTreasure( EntityManagerRef entities, SpriteAnimationSystemRef sprites ) const;
+    //! treasure whose expiry creates another like it
+    static Entity createRespawningTreasure( std::shared_ptr<const Scenario> scenario, std::weak_ptr<EntityManager> entities, std::weak_ptr<SpriteAnimationSystem> sprites );
+    Entity createPlanet( EntityManagerRef entities ) const;
+    Entity createPlayer( EntityManagerRef entities, SpriteAnimationSystemRef sprites ) const;
+    Entity createShip( EntityManagerRef entities, KeyboardInputRef input ) const;
+    Entity createRibbon( EntityManagerRef entities ) const;
+    Entity createParticle( EntityManagerRef entities ) const;
+    Entity createChain( EntityManagerRef entities ) const;
+  };
+} // puptent::
@@ -32,7 +32,7 @@ using namespace std;
 
 void ScriptSystem::update(shared_ptr<entityx::EntityManager> es, shared_ptr<entityx::EventManager> events, double dt)
 {
-  for( auto entity : es->entities_with_components<ScriptComponent>() )
+  for( auto entity : slice( es->entities_with_components<ScriptComponent>() ) )
   {
     auto script = entity.component<ScriptComponent>();
     script->update( entity, dt );
@@ -80,6 +80,8 @@ namespace puptent
    */
   struct ScriptSystem : public System<ScriptSystem>, Receiver<ScriptSystem>
   {
+    //! scripts may do anything, so we run alone
+    void declare( SystemAccess &access ) override { access.exclusive(); }
     //! gather scripts and execute them
     void update( EntityManagerRef es, EventManagerRef events, double dt ) override;
   };
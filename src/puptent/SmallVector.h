@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2013 David Wicks, sansumbrella.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace puptent
+{
+  /**
+   SmallVector:
+   A vector that keeps up to N elements inside itself, only going to the
+   heap when it grows beyond that.
+   Storage is kept when shrinking, so refilling up to the capacity, as the
+   RenderMesh setAs... methods do, never allocates.
+   Has the parts of std::vector's interface we use; iterators are pointers.
+  */
+  template<typename T, size_t N>
+  class SmallVector
+  {
+  public:
+    typedef T           value_type;
+    typedef T*          iterator;
+    typedef const T*    const_iterator;
+    typedef size_t      size_type;
+
+    SmallVector() = default;
+    explicit SmallVector( size_t count, const T &value = T() ) { assign( count, value ); }
+    SmallVector( const SmallVector &other ) { assign( other.begin(), other.end() ); }
+    SmallVector( SmallVector &&other ) { take( other ); }
+    ~SmallVector() { clear(); release(); }
+    SmallVector& operator = ( const SmallVector &other )
+    {
+      if( this != &other ){ assign( other.begin(), other.end() ); }
+      return *this;
+    }
+    SmallVector& operator = ( SmallVector &&other )
+    {
+      if( this != &other )
+      {
+        clear();
+        release();
+        take( other );
+      }
+      return *this;
+    }
+
+    size_t      size() const { return mSize; }
+    bool        empty() const { return mSize == 0; }
+    size_t      capacity() const { return mCapacity; }
+    //! true while the elements live inside the vector itself
+    bool        isInline() const { return mData == inlineData(); }
+
+    T*          data() { return mData; }
+    const T*    data() const { return mData; }
+    iterator        begin() { return mData; }
+    iterator        end() { return mData + mSize; }
+    const_iterator  begin() const { return mData; }
+    const_iterator  end() const { return mData + mSize; }
+    T&          front() { return mData[0]; }
+    const T&    front() const { return mData[0]; }
+    T&          back() { return mData[mSize - 1]; }
+    const T&    back() const { return mData[mSize - 1]; }
+    T&          operator [] ( size_t index ) { return mData[index]; }
+    const T&    operator [] ( size_t index ) const { return mData[index]; }
+    T&          at( size_t index ) { checkIndex( index ); return mData[index]; }
+    const T&    at( size_t index ) const { checkIndex( index ); return mData[index]; }
+
+    //! make room for \a count elements; moves them to the heap if N is too few
+    void reserve( size_t count )
+    {
+      if( count <= mCapacity ){ return; }
+      T *storage = static_cast<T*>( ::operator new( count * sizeof( T ) ) );
+      for( size_t i = 0; i < mSize; ++i )
+      {
+        new( storage + i ) T( std::move( mData[i] ) );
+        mData[i].~T();
+      }
+      release();
+      mData = storage;
+      mCapacity = count;
+    }
+    void assign( size_t count, const T &value )
+    {
+      T copy( value ); // value may be one of ours
+      clear();
+      reserve( count );
+      std::uninitialized_fill_n( mData, count, copy );
+      mSize = count;
+    }
+    template<typename Iter>
+    void assign( Iter first, Iter last )
+    {
+      clear();
+      reserve( std::distance( first, last ) );
+      for( ; first != last; ++first )
+      {
+        new( mData + mSize ) T( *first );
+        ++mSize;
+      }
+    }
+    void resize( size_t count, const T &value = T() )
+    {
+      T copy( value );
+      while( mSize > count ){ pop_back(); }
+      reserve( count );
+      for( ; mSize < count; ++mSize )
+      {
+        new( mData + mSize ) T( copy );
+      }
+    }
+    template<typename ... Args>
+    void emplace_back( Args && ... args )
+    {
+      if( mSize == mCapacity )
+      {
+        T element( std::forward<Args>( args ) ... ); // args may refer to one of ours
+        reserve( mCapacity ? mCapacity * 2 : 1 );
+        new( mData + mSize ) T( std::move( element ) );
+      }
+      else
+      {
+        new( mData + mSize ) T( std::forward<Args>( args ) ... );
+      }
+      ++mSize;
+    }
+    void push_back( const T &value ) { emplace_back( value ); }
+    void pop_back() { mData[--mSize].~T(); }
+    void clear()
+    {
+      for( size_t i = 0; i < mSize; ++i ){ mData[i].~T(); }
+      mSize = 0;
+    }
+  private:
+    T*        inlineData() { return reinterpret_cast<T*>( &mInline ); }
+    const T*  inlineData() const { return reinterpret_cast<const T*>( &mInline ); }
+    void      checkIndex( size_t index ) const
+    {
+      if( index >= mSize ){ throw std::out_of_range( "SmallVector::at" ); }
+    }
+    //! free heap storage; elements must already be destroyed
+    void release()
+    {
+      if( !isInline() ){ ::operator delete( mData ); }
+      mData = inlineData();
+      mCapacity = N;
+    }
+    //! steal other's elements, leaving it empty; we must be empty
+    void take( SmallVector &other )
+    {
+      if( other.isInline() )
+      {
+        for( size_t i = 0; i < other.mSize; ++i )
+        {
+          new( mData + i ) T( std::move( other.mData[i] ) );
+        }
+        mSize = other.mSize;
+        other.clear();
+      }
+      else
+      {
+        mData = other.mData;
+        mSize = other.mSize;
+        mCapacity = other.mCapacity;
+        other.mData = other.inlineData();
+        other.mSize = 0;
+        other.mCapacity = N;
+      }
+    }
+
+    typename std::aligned_storage<sizeof( T ) * N, alignof( T )>::type  mInline;
+    T       *mData = inlineData();
+    size_t  mSize = 0;
+    size_t  mCapacity = N;
+  };
+} // puptent::
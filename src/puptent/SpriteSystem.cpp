@@ -26,7 +26,7 @@
  */
 
 #include "puptent/SpriteSystem.h"
-#include "puptent/RenderMesh.h"
+#include "puptent/RenderSystem.h"
 #include "cinder/Json.h"
 
 using namespace puptent;
@@ -95,22 +95,42 @@ SpriteAnimationRef SpriteAnimationSystem::createSpriteAnimation(AnimationId anim
   return SpriteAnimationRef{ new SpriteAnimation{ animation_id } };
 }
 
+MeshGeometryRef SpriteAnimationSystem::getGeometry( const SpriteAnimation &sprite ) const
+{
+  const auto &drawings = mAnimations.at( sprite.animation ).drawings;
+  return drawings.at( math<int>::clamp( sprite.current_index, 0, drawings.size() - 1 ) ).geometry;
+}
+
 void SpriteAnimationSystem::receive(const ComponentAddedEvent<SpriteAnimation> &event)
 { // track the sprite
   auto entity = event.entity;
+  auto sprite = event.component;
+  const auto &drawings = mAnimations.at( sprite->animation ).drawings;
+  sprite->current_index = math<int>::clamp( sprite->current_index, 0, drawings.size() - 1 );
+  const auto &drawing = drawings.at( sprite->current_index );
   auto mesh = entity.component<RenderMesh>();
   if( mesh )
   {
-    auto sprite = event.component;
-    auto drawings = mAnimations.at( sprite->animation ).drawings;
-    sprite->current_index = math<int>::clamp( sprite->current_index, 0, drawings.size() - 1 );
-    mesh->matchTexture( drawings.at( sprite->current_index ).drawing );
+    mesh->matchTexture( drawing.drawing );
+  }
+  else if( auto quad = entity.component<SpriteQuad>() )
+  {
+    quad->matchTexture( drawing.drawing );
   }
+  else if( auto data = entity.component<RenderData>() )
+  {
+    data->setGeometry( drawing.geometry );
+  }
+}
+
+void SpriteAnimationSystem::declare( SystemAccess &access )
+{
+  access.writes<SpriteAnimation, RenderMesh, SpriteQuad, RenderData>();
 }
 
 void SpriteAnimationSystem::update( EntityManagerRef es, EventManagerRef events, double dt )
 {
-  for( auto entity : es->entities_with_components<SpriteAnimation, RenderMesh>() )
+  for( auto entity : slice( es->entities_with_components<SpriteAnimation>() ) )
   {
     auto sprite = entity.component<SpriteAnimation>();
     auto mesh = entity.component<RenderMesh>();
@@ -145,8 +165,10 @@ void SpriteAnimationSystem::update( EntityManagerRef es, EventManagerRef events,
     if( next_index != sprite->current_index )
     { // the frame index has changed, update display
       sprite->current_index = next_index;
-      const auto &next_drawing = anim.drawings.at( sprite->current_index ).drawing;
-      if( mesh ){ mesh->matchTexture( next_drawing ); }
+      const auto &next_drawing = anim.drawings.at( sprite->current_index );
+      if( mesh ){ mesh->matchTexture( next_drawing.drawing ); }
+      else if( auto quad = entity.component<SpriteQuad>() ){ quad->matchTexture( next_drawing.drawing ); }
+      else if( auto data = entity.component<RenderData>() ){ data->setGeometry( next_drawing.geometry ); }
     }
   }
 }
@@ -28,6 +28,7 @@
 #pragma once
 #include "puptent/PupTent.h"
 #include "puptent/TextureAtlas.h"
+#include "puptent/RenderMesh.h"
 #include "pockets/CollectionUtilities.hpp"
 
 namespace cinder
@@ -62,7 +63,9 @@ namespace puptent
   /**
    SpriteAnimationSystem:
    Plays back SpriteAnimations
-   Updates a RenderMesh component with the current animation frame
+   Updates a RenderMesh or SpriteQuad component with the current animation frame
+   Without either, points the entity's RenderData at the frame's shared
+   geometry instead; see getGeometry()
    Assumes that whatever renderer will bind the correct texture for display
    */
   typedef std::shared_ptr<class SpriteAnimationSystem> SpriteAnimationSystemRef;
@@ -72,10 +75,12 @@ namespace puptent
     {
       Drawing( const SpriteData &drawing=SpriteData{}, float hold=1.0f ):
       drawing( drawing ),
-      hold( hold )
+      hold( hold ),
+      geometry( MeshGeometry::create( drawing ) )
       {}
       SpriteData      drawing;  // size and texture information
       float           hold;     // frames to hold
+      MeshGeometryRef geometry; // drawing as a box, shared by every sprite showing it
     };
     struct Animation
     {
@@ -90,12 +95,18 @@ namespace puptent
     void configure( EventManagerRef events ) override;
     //! update mesh on sprite creation
     void receive( const ComponentAddedEvent<SpriteAnimation> &event );
+    //! advances animations and writes their frames into meshes, quads or RenderData geometry
+    //! finish_fn callbacks should stick to those components, too
+    void declare( SystemAccess &access ) override;
     void update( EntityManagerRef es, EventManagerRef events, double dt ) override;
     //! Create a component to play \a animation_name
     //! To display the animation properly, you will need to assign new component's mesh
     SpriteAnimationRef createSpriteAnimation( const std::string &animation_name ) const;
     //! Create a component to play \a animation_id
     SpriteAnimationRef createSpriteAnimation( AnimationId animation_id ) const;
+    //! Returns the shared geometry of \a sprite's current frame
+    //! Draw many sprites by giving their RenderData this instead of a RenderMesh
+    MeshGeometryRef    getGeometry( const SpriteAnimation &sprite ) const;
     //! Returns the id of \a animation_name
     AnimationId        getAnimationId( const std::string &animation_name ) const;
     //! Add a new animation to the system's list of animations
@@ -27,18 +27,26 @@
 
 #include "TextureAtlas.h"
 #include "cinder/Json.h"
+#ifndef PUPTENT_HEADLESS
 #include "cinder/gl/Texture.h"
+#endif
 
 using namespace cinder;
 using namespace puptent;
 using namespace std;
 
-TextureAtlas::TextureAtlas( const Surface &images, const ci::JsonTree &description )
+#ifndef PUPTENT_HEADLESS
+TextureAtlas::TextureAtlas( const Surface &images, const ci::JsonTree &description ):
+TextureAtlas( description )
 {
   gl::Texture::Format format;
   
   mTexture = gl::Texture::create( images, format );
+}
+#endif
 
+TextureAtlas::TextureAtlas( const ci::JsonTree &description )
+{
   JsonTree sprites = description["sprites"];
   JsonTree meta = description["meta"];
   Vec2i bitmap_size( meta["width"].getValue<int>(), meta["height"].getValue<int>() );
@@ -54,7 +62,14 @@ TextureAtlas::TextureAtlas( const Surface &images, const ci::JsonTree &descripti
   }
 }
 
+#ifndef PUPTENT_HEADLESS
 TextureAtlasUniqueRef TextureAtlas::create(const ci::Surface &images, const ci::JsonTree &description)
 {
   return TextureAtlasUniqueRef{ new TextureAtlas{ images, description } };
 }
+#endif
+
+TextureAtlasUniqueRef TextureAtlas::create( const ci::JsonTree &description )
+{
+  return TextureAtlasUniqueRef{ new TextureAtlas{ description } };
+}
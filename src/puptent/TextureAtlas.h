@@ -61,7 +61,11 @@ namespace puptent
   {
   public:
     TextureAtlas() = default;
+#ifndef PUPTENT_HEADLESS
     TextureAtlas( const ci::Surface &images, const ci::JsonTree &description );
+#endif
+    //! sprite lookup only, with no texture; needs no GL context
+    explicit TextureAtlas( const ci::JsonTree &description );
     //! returns SpriteData with string id \a sprite_name or default sprite if none exists
     inline const SpriteData& get( const std::string &sprite_name ) const
     {
@@ -77,13 +81,19 @@ namespace puptent
     {
       return get( sprite_name );
     }
+#ifndef PUPTENT_HEADLESS
     //! returns the texture where sprites are stored on GPU
     ci::gl::TextureRef  getTexture() const { return mTexture; }
     //! create a new texture atlas from a surface and json description
     static TextureAtlasUniqueRef create( const ci::Surface &images, const ci::JsonTree &description );
+#endif
+    //! create a texture-less atlas from a json description, eg. for running headless
+    static TextureAtlasUniqueRef create( const ci::JsonTree &description );
   private:
     std::map<std::string, SpriteData>   mData;
+#ifndef PUPTENT_HEADLESS
     ci::gl::TextureRef                  mTexture;
+#endif
     SpriteData                          mErrorData;
   };
 